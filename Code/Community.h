@@ -39,6 +39,13 @@
  *    a shared function or characteristic or something similar.
  */
 class Community:public Group{
+ public:
+  /**
+   *@fn Community()
+   *
+   * Empty community. Members are charged to MEM_COMMUNITIES.
+   */
+  Community():Group ( MEM_COMMUNITIES ){}
 };
 
 #endif
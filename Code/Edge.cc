@@ -25,32 +25,40 @@
  */
 
 #include "Edge.h"
+#include "LagSamplerCache.h"
+#include "InteractionModel.h"
+#include "EventStream.h"
+#include "../../Libraries/Random/Wrappers.h"
 
-bool Edge::generateWeight ( unique_ptr < Parameters > & P ) {
-  //Sets up power law for edge frequency - will change
-  //  based off of how many other edges the members are 
-  //  actively involved in. This means the same edge might have
-  //  different lag/energy distributions in different time windows
-  PowerLaw pl ( -1.75, getTotalEnergy(P->get < double > ( "grav",0.2 ), P-> get < double > ( "minlag", 0.2 ), P->get < double > ( "vmax", 1 ) ), 3.0 ); 
-  edge_weight_ = 0;
-  
-  //wait_time_ represents the time at which the next interaction 
-  //   between members of the edge will happen ( sorry for the
-  //   slight misnomer ). If wait_time is 0.27, it means that 
-  //   the next interaction will happen 0.27 time units into a 
-  //   time window [0, 1)
-  while ( wait_time_ < 1.0 ){
-    wait_time_ += pl.Sample();
-    ++edge_weight_;
-  }
+/**
+ *@struct SharedUniform
+ *
+ *   Uniforms from the shared rand() state.
+ */
+struct SharedUniform {
+  double operator() ( ) { return random_double(); }
+};
 
-  //Track that the time window has passed
-  wait_time_ -= 1.0;
+bool Edge::generateWeight ( const LagSamplerCache& cache, bool track_edges, EventStream* events ) {
+  SharedUniform draw;
+  return simulate ( cache, draw, track_edges, events );
+}
+
+bool Edge::generateWeight ( const LagSamplerCache& cache, rstream& rng, bool track_edges, EventStream* events ) {
+  //Same process as above with uniforms from rng
+  auto draw = [&rng] ( ) { return uniform ( rng ); };
+  return simulate ( cache, draw, track_edges, events );
+}
+
+template < class Draw >
+bool Edge::simulate ( const LagSamplerCache& cache, Draw& draw, bool track_edges, EventStream* events ){
+  auto record = [&] ( double offset ) { if ( events ) events->record ( offset, members_ ); };
+  edge_weight_ = simulateWindow ( cache, members_, wait_time_, draw, record );
 
   //Increment the number of active edges the members of this edge
   //    are involved in this edge if at least interaction has 
   //    happened in the current time window.
-  if ( edge_weight_ > 0 ){
+  if ( track_edges && ( edge_weight_ > 0 ) ){
     vset::iterator it_v;
     for ( it_v = members_.begin(); it_v != members_.end(); it_v++ ){
       (*it_v)->incrementEdgeCount();
@@ -61,39 +69,6 @@ bool Edge::generateWeight ( unique_ptr < Parameters > & P ) {
   return edge_weight_ > 0;
 }
 
-double Edge::getTotalEnergy ( double gravity, double minlag, double max_energy ){
-  double res = -1;
-  double max_res = 0;
-  bool considered = false;
-
-  // Lag is the inverse of energy ( high energy vertices have 
-  //      frequent or low lag interactions ). Finds the max lag.
-  vset::iterator it_v;
-  for ( it_v = members_.begin(); it_v != members_.end(); it_v++ ){
-    double v_lag = ( max_energy - (*it_v)->getEnergy() ) + minlag;
-    if ( v_lag > res ) {
-      res = v_lag;
-    }
-  }
-
-  max_res = res;
-
-  // Adds influence of lag values that are not the maximum. 
-  //    The idea is that a high lag - low lag vertex edge should
-  //    connect more than a two-low-lag-vertex edge. 
-  for ( it_v = members_.begin(); it_v != members_.end(); it_v++ ){
-    double v_lag = ( max_energy - (*it_v)->getEnergy() ) + minlag;
-    if ( ( v_lag == max_res ) && (!considered) ){
-      considered = true;
-      continue;
-    } else {
-      res -= ( gravity * ( res - v_lag ) );
-    }
-  }
-
-  return res;
-}
-
 string Edge::toString ( ) {
   string res = "";
 
@@ -33,6 +33,9 @@
 
 using namespace std;
 
+class EventStream;
+class LagSamplerCache;
+
 /**
  *@class Edge:public Group
  *
@@ -53,23 +56,39 @@ class Edge:public Group {
    *@fn Edge()
    *
    * Initializes the next weight time and current edge weight to zero.
+   *     Members are charged to MEM_EDGES.
    */
- Edge():Group(), wait_time_(0), edge_weight_(0){}
+ Edge():Group ( MEM_EDGES ), wait_time_(0), edge_weight_(0){}
   /**
    *@fn ~Edge()
    */
   ~Edge(){}
   
   /**
-   *@fn bool generateWeight(unique_ptr < Parameters >& P )
+   *@fn bool generateWeight(const LagSamplerCache& cache, bool track_edges, EventStream* events )
    *
    *  Simulates waiting times for the edge until the threshold for the current
    * window is reached. The number of interactions that occured is set as the
    * edge weight.
    *
+   *@param cache Interaction model and wait time samplers of the network
+   *@param track_edges If false, the active edge counts of the members are
+   *                   left alone ( used when only priming the wait time )
+   *@param events If given, every interaction is recorded there with its
+   *              time inside the window
    *@return True if at least one interaction occured in the time window
    */
-  bool generateWeight(unique_ptr < Parameters >& P );
+  bool generateWeight(const LagSamplerCache& cache, bool track_edges = true, EventStream* events = NULL );
+
+  /**
+   *@fn bool generateWeight(const LagSamplerCache& cache, rstream& rng, bool track_edges, EventStream* events )
+   *
+   *  Same as above, but every wait time is drawn from the given stream
+   * instead of the shared rand() state, so edges can be processed
+   * from several threads at once ( with track_edges false, as the
+   * members' edge counts are not updated atomically ).
+   */
+  bool generateWeight(const LagSamplerCache& cache, rstream& rng, bool track_edges, EventStream* events = NULL );
 
   /**
    *@fn string toString()
@@ -91,22 +110,37 @@ class Edge:public Group {
    */
   double getWeight ( ) { return edge_weight_; }
 
+  /**
+   *@fn void setWeight ( double weight )
+   *
+   *  Sets the weight directly, for edges read from an existing network.
+   */
+  void setWeight ( double weight ) { edge_weight_ = weight; }
+
+  /**
+   *@fn double getWaitTime ( )
+   *@fn void setWaitTime ( double wait_time )
+   *
+   *  Access to the carried over wait time, so that edge state can be
+   * stored outside of the edge object between windows.
+   */
+  double getWaitTime ( ) { return wait_time_; }
+  void setWaitTime ( double wait_time ) { wait_time_ = wait_time; }
+
  private:
   double wait_time_;         //Tracks time until the next interaction
   double edge_weight_;       //Holds the number of interactions that happened
                              //   in 'current' time window.
 
   /**
-   *@fn double getTotalEnergy( double gravity, double minlag, double max_energy)
-   *
-   *  Wait times for the edge are modelled by a power law. The power law needs 
-   *     a parameter to determine it's behavior ( the exponent ). This function
-   *     calculates an appropriate function for the exponent based on the energy
-   *     levels of the consituent members.
+   *@fn bool simulate ( const LagSamplerCache& cache, Draw& draw, bool track_edges, EventStream* events )
    *
-   *@return A weighted average of the energy levels of edge members
+   *   Runs the window's interactions under the model held by cache
+   * ( see simulateWindow in InteractionModel.h ). draw() returns the
+   * next uniform in [0,1).
    */
-  double getTotalEnergy( double gravity, double minlag, double max_energy);
+  template < class Draw >
+  bool simulate ( const LagSamplerCache& cache, Draw& draw, bool track_edges, EventStream* events );
 };
 
 /**
@@ -131,6 +165,18 @@ struct cmp_pedge{
   }
 };
 
-typedef set < shared_ptr < Edge >, cmp_pedge > eset;
+/**
+ *@typedef basic_eset
+ *
+ * Edge set with a chosen allocator for its nodes. eset, used
+ *     throughout, takes its nodes from a NodeArena of its own and
+ *     charges them to the tag it is built with ( see MemoryAccount.h ),
+ *     so a window's set gives its memory back in one step when it is
+ *     dropped.
+ */
+template < class Alloc = TrackedAllocator < shared_ptr < Edge >, ArenaAllocator > >
+using basic_eset = set < shared_ptr < Edge >, cmp_pedge, Alloc >;
+
+typedef basic_eset < > eset;
 
 #endif
@@ -0,0 +1,120 @@
+/**
+ *@file EdgeIndex.cc
+ *
+ *   Definitions for building and reading edge list indexes.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EdgeIndex.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+
+static const char INDEX_MAGIC[8] = "RPIIDX1";
+
+unsigned long writeEdgeIndex ( const string& filename, const vector < BinaryEdgeRecord >& edges, ThreadPool& pool ){
+  EdgeIndexHeader header;
+  memcpy ( header.magic, INDEX_MAGIC, sizeof ( header.magic ) );
+  header.vertices = 0;
+  header.reserved = 0;
+  header.edges = edges.size();
+  for ( size_t i = 0; i < edges.size(); i++ ){
+    header.vertices = max ( header.vertices, max ( edges[i].a, edges[i].b ) + 1 );
+  }
+
+  //Prefix sums of degrees give the row offsets
+  vector < uint64_t > offsets ( header.vertices + 1, 0 );
+  for ( size_t i = 0; i < edges.size(); i++ ){
+    ++offsets[edges[i].a + 1];
+    ++offsets[edges[i].b + 1];
+  }
+  for ( uint32_t v = 0; v < header.vertices; v++ ){
+    offsets[v+1] += offsets[v];
+  }
+
+  vector < pair < uint32_t, double > > entries ( offsets[header.vertices] );
+  vector < uint64_t > fill ( offsets.begin(), offsets.end() - 1 );
+  for ( size_t i = 0; i < edges.size(); i++ ){
+    entries[fill[edges[i].a]++] = make_pair ( edges[i].b, edges[i].weight );
+    entries[fill[edges[i].b]++] = make_pair ( edges[i].a, edges[i].weight );
+  }
+  vector < uint64_t > ().swap ( fill );
+
+  pool.parallelFor ( 0, header.vertices, 256, [&] ( size_t lo, size_t hi ) {
+      for ( size_t v = lo; v < hi; v++ ){
+	sort ( entries.begin() + offsets[v], entries.begin() + offsets[v+1] );
+      }
+    } );
+
+  //Rows are split into the id and weight arrays on the way out
+  vector < uint32_t > ids ( entries.size() );
+  vector < double > weights ( entries.size() );
+  for ( size_t i = 0; i < entries.size(); i++ ){
+    ids[i] = entries[i].first;
+    weights[i] = entries[i].second;
+  }
+
+  ofstream fout ( filename.c_str(), ios::binary );
+  fout.write ( reinterpret_cast < const char* > ( &header ), sizeof ( header ) );
+  fout.write ( reinterpret_cast < const char* > ( &offsets[0] ), offsets.size() * sizeof ( uint64_t ) );
+  if ( !ids.empty() ) fout.write ( reinterpret_cast < const char* > ( &ids[0] ), ids.size() * sizeof ( uint32_t ) );
+  if ( ids.size() % 2 ){
+    uint32_t padding = 0;
+    fout.write ( reinterpret_cast < const char* > ( &padding ), sizeof ( padding ) );
+  }
+  if ( !weights.empty() ) fout.write ( reinterpret_cast < const char* > ( &weights[0] ), weights.size() * sizeof ( double ) );
+
+  unsigned long bytes = fout.tellp();
+  fout.close();
+  return bytes;
+}
+
+EdgeIndex::EdgeIndex ( const string& filename ): file_ ( filename ) {
+  if ( ( file_.size() < sizeof ( EdgeIndexHeader ) ) || ( memcmp ( file_.data(), INDEX_MAGIC, sizeof ( INDEX_MAGIC ) ) != 0 ) ){
+    throw runtime_error ( filename + " is not an edge index" );
+  }
+  header_ = reinterpret_cast < const EdgeIndexHeader* > ( file_.data() );
+
+  uint64_t entries = 2 * header_->edges;
+  size_t offsets_at = sizeof ( EdgeIndexHeader );
+  size_t neighbors_at = offsets_at + ( header_->vertices + 1 ) * sizeof ( uint64_t );
+  size_t weights_at = neighbors_at + ( entries + entries % 2 ) * sizeof ( uint32_t );
+  if ( file_.size() != weights_at + entries * sizeof ( double ) ){
+    throw runtime_error ( filename + " is truncated" );
+  }
+
+  offsets_ = reinterpret_cast < const uint64_t* > ( file_.data() + offsets_at );
+  neighbors_ = reinterpret_cast < const uint32_t* > ( file_.data() + neighbors_at );
+  weights_ = reinterpret_cast < const double* > ( file_.data() + weights_at );
+}
+
+double EdgeIndex::weight ( unsigned int u, unsigned int v ) const {
+  //The shorter row is searched
+  if ( degree ( v ) < degree ( u ) ) swap ( u, v );
+
+  const uint32_t* row = neighbors ( u );
+  const uint32_t* end = row + degree ( u );
+  const uint32_t* it = lower_bound ( row, end, v );
+  if ( ( it == end ) || ( *it != v ) ) return 0;
+  return weights ( u )[it - row];
+}
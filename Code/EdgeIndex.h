@@ -0,0 +1,126 @@
+/**
+ *@file EdgeIndex.h
+ *
+ *   Random-access index over a window's edge list. The index is the
+ * window's adjacency in compressed sparse row form, stored in a file
+ * next to the edge list ( NetworkN.idx ) and read through mmap, so a
+ * neighbor or edge lookup touches a few pages instead of the whole
+ * window.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_EDGEINDEX
+#define RPI_EDGEINDEX
+
+#include "Loader.h"
+#include <stdint.h>
+
+using namespace std;
+
+/**
+ *@struct EdgeIndexHeader
+ *
+ *   Start of an index file. It is followed by
+ *      uint64 offsets[vertices+1]
+ *      uint32 neighbors[2*edges]   ( each row sorted by id )
+ *      uint32 padding, if needed to align the weights
+ *      double weights[2*edges]     ( weight of each neighbor entry )
+ *   Row v holds entries offsets[v] to offsets[v+1]. Every edge is in
+ *   the rows of both of its ends.
+ */
+struct EdgeIndexHeader {
+  char magic[8];                 //"RPIIDX1"
+  uint32_t vertices;             //Id range: highest id + 1
+  uint32_t reserved;
+  uint64_t edges;
+};
+
+/**
+ *@fn unsigned long writeEdgeIndex ( const string& filename, const vector < BinaryEdgeRecord >& edges, ThreadPool& pool )
+ *
+ *   Builds the index of an edge list and writes it. Rows are sorted
+ * on the pool.
+ *
+ *@param filename Index file to write
+ *@param edges Edges of the window, one record per pair
+ *@param pool Threads used for sorting
+ *@return Bytes written
+ */
+unsigned long writeEdgeIndex ( const string& filename, const vector < BinaryEdgeRecord >& edges, ThreadPool& pool );
+
+/**
+ *@class EdgeIndex
+ *
+ *   Read-only view of an index file. Lookups are binary searches in
+ * the mapped rows.
+ */
+class EdgeIndex {
+ public:
+  /**
+   *@fn EdgeIndex ( const string& filename )
+   *
+   *   Maps the index. Throws runtime_error if the file cannot be
+   * mapped or is not an index.
+   */
+  EdgeIndex ( const string& filename );
+
+  unsigned int numVertices ( ) const { return header_->vertices; }
+  unsigned long numEdges ( ) const { return header_->edges; }
+
+  /**
+   *@fn unsigned long degree ( unsigned int v ) const
+   *
+   *@return Number of neighbors of v ( 0 for ids outside the window )
+   */
+  unsigned long degree ( unsigned int v ) const {
+    return ( v < header_->vertices ) ? offsets_[v+1] - offsets_[v] : 0;
+  }
+
+  /**
+   *@fn const uint32_t* neighbors ( unsigned int v ) const
+   *@fn const double* weights ( unsigned int v ) const
+   *
+   *@return Start of v's row; degree(v) entries are valid
+   */
+  const uint32_t* neighbors ( unsigned int v ) const {
+    return neighbors_ + ( ( v < header_->vertices ) ? offsets_[v] : 0 );
+  }
+  const double* weights ( unsigned int v ) const {
+    return weights_ + ( ( v < header_->vertices ) ? offsets_[v] : 0 );
+  }
+
+  /**
+   *@fn double weight ( unsigned int u, unsigned int v ) const
+   *
+   *@return Weight of the edge between u and v, 0 if there is none
+   */
+  double weight ( unsigned int u, unsigned int v ) const;
+
+ private:
+  MappedFile file_;
+  const EdgeIndexHeader* header_;
+  const uint64_t* offsets_;
+  const uint32_t* neighbors_;
+  const double* weights_;
+};
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ *@file EnergySampler.cc
+ *
+ *   Definitions of the member functions for the EnergySampler class.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EnergySampler.h"
+#include <algorithm>
+
+void EnergySampler::append ( const double* energies, size_t n ){
+  //Running sum picks up where the index currently ends
+  size_t start = cumulative_.size();
+  double running = total();
+
+  cumulative_.resize ( start + n );
+  for ( size_t i = 0; i < n; i++ ){
+    running += energies[i];
+    cumulative_[start + i] = running;
+  }
+}
+
+size_t EnergySampler::sample ( double u ) const {
+  //First slot whose running sum passes the target
+  double target = u * total();
+  size_t res = upper_bound ( cumulative_.begin(), cumulative_.end(), target ) - cumulative_.begin();
+
+  //Guards against rounding at the very top of the range
+  return ( res < cumulative_.size() ) ? res : cumulative_.size() - 1;
+}
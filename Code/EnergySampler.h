@@ -0,0 +1,155 @@
+/**
+ *@file EnergySampler.h
+ *
+ *   Index used to pick vertices with probability proportional to
+ * their energy.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_ESAMPLER
+#define RPI_ESAMPLER
+
+#include <vector>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+
+using namespace std;
+
+/**
+ *@class EnergySampler
+ *
+ *   Running sums of the energies of vertices, in the same order as
+ * the vertices are stored by the network ( slot order ). A draw is
+ * a binary search for a uniform target in the running sums, so
+ * picking a vertex is O(log V) instead of a walk over all vertices.
+ *
+ *   The index is only read while sampling, so any number of threads
+ * can draw from it at once as long as nothing is being appended.
+ */
+class EnergySampler {
+ public:
+  /**
+   *@fn void append ( const double* energies, size_t n )
+   *
+   *   Extends the index by n new slots in one step.
+   *
+   *@param energies Energies of the new slots
+   *@param n Number of new slots
+   */
+  void append ( const double* energies, size_t n );
+
+  /**
+   *@fn size_t sample ( double u ) const
+   *
+   *@param u Uniform value in [0,1)
+   *@return Slot whose energy interval contains u * total()
+   */
+  size_t sample ( double u ) const;
+
+  /**
+   *@fn void sampleDistinct ( size_t count, D draw, X excluded, double excluded_mass, vector < size_t >& out ) const
+   *
+   *   Draws count distinct slots, each weighted by energy, skipping
+   * slots that are excluded ( e.g. already in a community ). Gives
+   * the same distribution as drawing one at a time and retrying on
+   * repeats, without the unbounded retries.
+   *
+   *   While at least half of the total energy is still available,
+   * plain draws are rejected when they hit a taken slot, so each
+   * accepted slot costs at most two draws on average. Past that
+   * point, the rest are picked in one pass over the index with
+   * Efraimidis-Spirakis keys ( log(u) / weight, largest win ).
+   *
+   *   If fewer than count slots are available, all of them are
+   * returned.
+   *
+   *@param count Number of slots wanted
+   *@param draw Callable returning a uniform double in [0,1)
+   *@param excluded Callable taking a slot, true if it may not be drawn
+   *@param excluded_mass Total energy of the excluded slots
+   *@param out Filled with the drawn slots, in the order drawn
+   */
+  template < class D, class X >
+  void sampleDistinct ( size_t count, D draw, X excluded, double excluded_mass, vector < size_t >& out ) const {
+    out.clear();
+    if ( ( count == 0 ) || cumulative_.empty() ) return;
+
+    unordered_set < size_t > picked;
+    while ( ( out.size() < count ) && ( excluded_mass < total() / 2 ) ){
+      size_t slot = sample ( draw() );
+      if ( picked.count ( slot ) || excluded ( slot ) ) continue;
+
+      picked.insert ( slot );
+      out.push_back ( slot );
+      excluded_mass += weight ( slot );
+    }
+    if ( out.size() == count ) return;
+
+    vector < pair < double, size_t > > keys;
+    for ( size_t s = 0; s < cumulative_.size(); s++ ){
+      double w = weight ( s );
+      if ( ( w <= 0 ) || picked.count ( s ) || excluded ( s ) ) continue;
+      keys.push_back ( make_pair ( log ( 1.0 - draw() ) / w, s ) );
+    }
+
+    size_t needed = min ( count - out.size(), keys.size() );
+    partial_sort ( keys.begin(), keys.begin() + needed, keys.end(), [] ( const pair < double, size_t >& a, const pair < double, size_t >& b ) { return a.first > b.first; } );
+    for ( size_t i = 0; i < needed; i++ ){
+      out.push_back ( keys[i].second );
+    }
+  }
+
+  /**
+   *@fn double weight ( size_t slot ) const
+   *
+   *@return Energy of the given slot
+   */
+  double weight ( size_t slot ) const {
+    return ( slot == 0 ) ? cumulative_[0] : cumulative_[slot] - cumulative_[slot-1];
+  }
+
+  /**
+   *@fn double total ( ) const
+   *
+   *@return Sum of all energies in the index
+   */
+  double total ( ) const { return cumulative_.empty() ? 0 : cumulative_.back(); }
+
+  /**
+   *@fn size_t size ( ) const
+   *
+   *@return Number of slots in the index
+   */
+  size_t size ( ) const { return cumulative_.size(); }
+
+  /**
+   *@fn void clear ( )
+   */
+  void clear ( ) { cumulative_.clear(); }
+
+ private:
+  vector < double > cumulative_;   //cumulative_[i] = sum of energies 0..i
+};
+
+#endif
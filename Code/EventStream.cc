@@ -0,0 +1,84 @@
+/**
+ *@file EventStream.cc
+ *
+ *   Definitions of the member functions for the EventStream class.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EventStream.h"
+
+EventStream::EventStream ( const string& prefix, const string& spill_prefix, size_t capacity, ThreadPool& pool ): prefix_(prefix), spill_prefix_(spill_prefix), capacity_(capacity), pool_(pool), window_(-1), charged_(0) {}
+
+void EventStream::open ( ){
+  ++window_;
+
+  buffers_.clear();
+  size_t per_thread = max < size_t > ( capacity_ / pool_.size(), 1024 );
+  charged_ = per_thread * pool_.size() * sizeof ( EventRecord );
+  MemoryAccount::add ( MEM_OUTPUT, charged_ );
+  for ( int i = 0; i < pool_.size(); i++ ){
+    string run_prefix = spill_prefix_ + "-events" + to_str < int > ( window_ ) + "-t" + to_str < int > ( i );
+    buffers_.push_back ( unique_ptr < RunSorter < EventRecord > > ( new RunSorter < EventRecord > ( run_prefix, per_thread ) ) );
+  }
+}
+
+void EventStream::record ( double offset, const vset& members ){
+  RunSorter < EventRecord >& buffer = *buffers_[pool_.threadIndex()];
+  EventRecord rec;
+  rec.time = window_ + offset;
+
+  vset::const_iterator it_a, it_b;
+  for ( it_a = members.begin(); it_a != members.end(); it_a++ ){
+    it_b = it_a;
+    for ( ++it_b; it_b != members.end(); it_b++ ){
+      rec.u = (*it_a)->getID();
+      rec.v = (*it_b)->getID();
+      buffer.push ( rec );
+    }
+  }
+}
+
+unsigned long EventStream::close ( ){
+  vector < string > runs;
+  for ( unsigned int i = 0; i < buffers_.size(); i++ ){
+    const vector < string >& thread_runs = buffers_[i]->finish();
+    runs.insert ( runs.end(), thread_runs.begin(), thread_runs.end() );
+  }
+
+  unsigned long written = 0;
+  {
+    RunMerger < EventRecord > merged ( runs, max < size_t > ( capacity_ * sizeof ( EventRecord ) / 4, 1 << 20 ) );
+    RunWriter < EventRecord > out ( prefix_ + to_str < int > ( window_ ) + ".bin" );
+    EventRecord rec;
+    while ( merged.next ( rec ) ){
+      out.write ( rec );
+      ++written;
+    }
+    out.close();
+  }
+
+  //Dropping the sorters deletes their runs
+  buffers_.clear();
+  MemoryAccount::sub ( MEM_OUTPUT, charged_ );
+
+  return written * sizeof ( EventRecord );
+}
@@ -0,0 +1,101 @@
+/**
+ *@file EventStream.h
+ *
+ *   Output of the individual interactions behind edge weights, as a
+ * time ordered binary link stream per window.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_EVENTS
+#define RPI_EVENTS
+
+#include "Vertex.h"
+#include "ExternalSort.h"
+#include "ThreadPool.h"
+#include <memory>
+
+using namespace std;
+
+/**
+ *@class EventStream
+ *
+ *   Collects the ( time, u, v ) interactions simulated by
+ * Edge::generateWeight while a window's weights are generated, and
+ * writes them to a file of EventRecord in time order.
+ *
+ *   Each thread of the pool has its own bounded buffer. A full
+ * buffer is sorted and written out as a run, and when the window is
+ * closed all runs are k-way merged into the output file, so memory
+ * stays at threads * capacity records however many events there are.
+ */
+class EventStream {
+ public:
+  /**
+   *@fn EventStream ( const string& prefix, const string& spill_prefix, size_t capacity, ThreadPool& pool )
+   *
+   *@param prefix Output files are prefix + window + ".bin"
+   *@param spill_prefix Path prefix for sorted runs
+   *@param capacity Records buffered in memory, over all threads
+   *@param pool Pool whose threads will record events
+   */
+  EventStream ( const string& prefix, const string& spill_prefix, size_t capacity, ThreadPool& pool );
+
+  /**
+   *@fn void open ( )
+   *
+   *   Starts collecting the events of the next window. Windows are
+   * numbered from 0 in the order they are opened.
+   */
+  void open ( );
+
+  /**
+   *@fn void record ( double offset, const vset& members )
+   *
+   *   Records one interaction of an edge, for every pair of its
+   * members. Safe to call from any thread of the pool.
+   *
+   *@param offset Time of the interaction inside the window, in [0,1)
+   *@param members Members of the interacting edge
+   */
+  void record ( double offset, const vset& members );
+
+  /**
+   *@fn unsigned long close ( )
+   *
+   *   Merges everything recorded since open() into the window's
+   * output file and removes the runs.
+   *
+   *@return Bytes written to the output file
+   */
+  unsigned long close ( );
+
+ private:
+  string prefix_;
+  string spill_prefix_;
+  size_t capacity_;
+  ThreadPool& pool_;
+  int window_;
+  vector < unique_ptr < RunSorter < EventRecord > > > buffers_;  //One per thread
+  size_t charged_;               //Buffer bytes charged to MEM_OUTPUT
+};
+
+#endif
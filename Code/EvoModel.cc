@@ -0,0 +1,88 @@
+/**
+ *@file EvoModel.cc
+ *
+ *   Definitions of the member functions for the EvoModel class.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EvoModel.h"
+
+EvoModel::EvoModel ( const map < string, string >& config ): started_(false), reported_(false) {
+  //Turns the configuration into command line style arguments
+  vector < string > args ( 1, "RPI-evo-model" );
+  map < string, string >::const_iterator it_c;
+  for ( it_c = config.begin(); it_c != config.end(); it_c++ ){
+    args.push_back ( "-" + it_c->first );
+    if ( !it_c->second.empty() ) args.push_back ( it_c->second );
+  }
+
+  vector < char* > argv;
+  for ( unsigned int i = 0; i < args.size(); i++ ){
+    argv.push_back ( const_cast < char* > ( args[i].c_str() ) );
+  }
+  init ( argv.size(), &argv[0] );
+}
+
+EvoModel::EvoModel ( int argc, char** argv ): started_(false), reported_(false) {
+  init ( argc, argv );
+}
+
+void EvoModel::init ( int argc, char** argv ){
+  P_.reset ( new Parameters() );
+  P_->Read ( argc, argv );
+  N_.reset ( new Network ( P_ ) );
+  if ( P_->hasFlag ( "history" ) ){
+    history_.reset ( new WindowHistory ( P_->get < unsigned int > ( "history" ) ) );
+  }
+}
+
+WindowView EvoModel::step ( ){
+  if ( !started_ ){
+    if ( P_->hasFlag ( "in" ) ) N_->loadNetwork ( P_ );
+    else N_->RandomNetwork ( P_ );
+    started_ = true;
+  } else {
+    //The previous window is reported once the caller is done with it
+    report();
+    N_->genNextTimeWindow ( P_ );
+  }
+  reported_ = false;
+  if ( history_ ) history_->capture ( *N_ );
+
+  return WindowView ( *N_ );
+}
+
+void EvoModel::run ( unsigned int windows, const function < void ( WindowView& ) >& callback ){
+  for ( unsigned int i = 0; i < windows; i++ ){
+    WindowView view = step();
+    callback ( view );
+    report();
+  }
+}
+
+void EvoModel::report ( ){
+  if ( !started_ || reported_ ) return;
+
+  N_->reportMemory();
+  N_->reportProfile();
+  reported_ = true;
+}
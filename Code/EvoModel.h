@@ -0,0 +1,188 @@
+/**
+ *@file EvoModel.h
+ *
+ *   Embeddable interface to the model. Programs linking against
+ * librpievo.a construct an EvoModel from a configuration, step it
+ * one window at a time and look at each window in memory through
+ * a WindowView, without going through the NetworkN.dat files.
+ *
+ *   Example:
+ *
+ *      map < string, string > config;
+ *      config["V"] = "100000";
+ *      config["seed"] = "7";
+ *      EvoModel model ( config );
+ *      model.run ( 10, [] ( WindowView& W ) {
+ *        W.forEachEdge ( [] ( unsigned int a, unsigned int b, double w ) { ... } );
+ *      } );
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_EVOMODEL
+#define RPI_EVOMODEL
+
+#include "Network.h"
+#include "WindowHistory.h"
+#include <map>
+#include <functional>
+
+using namespace std;
+
+/**
+ *@class WindowView
+ *
+ *   Read-only view of the window the model currently holds. It
+ * refers directly to the model's edge and community structures, so
+ * it is only valid until the model is stepped again. Edges are read
+ * in place, except in the out-of-core modes where they only exist on
+ * disk: a spilled window ( -membudget ) reads its state table and a
+ * streamed one ( -stream ) parses its edge list file on every
+ * forEachEdge, one edge at a time.
+ */
+class WindowView {
+ public:
+ WindowView ( Network& N ): N_(N) {}
+
+  /**
+   *@fn unsigned int window ( )
+   *
+   *@return Index of the window being viewed ( 0 is the first )
+   */
+  unsigned int window ( ) { return N_.getWindow(); }
+
+  /**
+   *@fn unsigned int numVertices ( )
+   *
+   *@return Vertex count of the window
+   */
+  unsigned int numVertices ( ) { return N_.NumVerts(); }
+
+  /**
+   *@fn void forEachEdge ( F f )
+   *
+   *   Calls f ( a, b, weight ) for each edge with a positive weight,
+   * with a < b. Edges are ordered by ( a, b ), except in a streamed
+   * window ( -stream ), where they come in community order as they
+   * were written. See Network::visitEdges.
+   */
+  template < class F >
+  void forEachEdge ( F f ) { N_.visitEdges ( f ); }
+
+  /**
+   *@fn void forEachCommunity ( F f )
+   *
+   *   Calls f ( id, members ) for each non-empty community. Ids are
+   * stable across windows. See Network::visitCommunities.
+   */
+  template < class F >
+  void forEachCommunity ( F f ) { N_.visitCommunities ( f ); }
+
+ private:
+  Network& N_;
+};
+
+/**
+ *@class EvoModel
+ *
+ *   Owns the parameters and the network for one run of the model.
+ */
+class EvoModel {
+ public:
+  /**
+   *@fn EvoModel ( const map < string, string >& config )
+   *@fn EvoModel ( int argc, char** argv )
+   *
+   *   Builds the parameters either from key/value pairs ( keys are
+   * the parameter names in the README, without the '-' ) or from
+   * command line style arguments.
+   */
+  EvoModel ( const map < string, string >& config );
+  EvoModel ( int argc, char** argv );
+
+  /**
+   *@fn WindowView step ( )
+   *
+   *   Generates the next window. The first call constructs the
+   * initial network ( random, or loaded with -in ), every later call
+   * reports the previous window if that was not done yet and evolves
+   * the network by one window.
+   *
+   *@return View of the newly generated window
+   */
+  WindowView step ( );
+
+  /**
+   *@fn void run ( unsigned int windows, const function < void ( WindowView& ) >& callback )
+   *
+   *   Steps the model the given number of times, handing each
+   * window to the callback as soon as it is generated and reporting
+   * it once the callback returns.
+   *
+   *@param windows Number of windows to generate
+   *@param callback Called once per window
+   */
+  void run ( unsigned int windows, const function < void ( WindowView& ) >& callback );
+
+  /**
+   *@fn void report ( )
+   *
+   *   Logs the memory ( -memlog ) and hardware counter ( -profile )
+   * summaries of the current window, once per window. Call it after
+   * the window's output, so the summaries cover that as well.
+   */
+  void report ( );
+
+  /**
+   *@fn Network& network ( )
+   *
+   *@return The underlying network, for callers needing more control
+   */
+  Network& network ( ) { return *N_; }
+
+  /**
+   *@fn unique_ptr < Parameters >& parameters ( )
+   *
+   *@return The parameters the model was built with
+   */
+  unique_ptr < Parameters >& parameters ( ) { return P_; }
+
+  /**
+   *@fn const WindowHistory* history ( )
+   *
+   *   With -history K, every generated window is captured, so the
+   * last K windows can be queried after the model has moved on.
+   *
+   *@return The kept windows, or NULL without -history
+   */
+  const WindowHistory* history ( ) { return history_.get(); }
+
+ private:
+  unique_ptr < Parameters > P_;
+  unique_ptr < Network > N_;
+  bool started_;              //True once the first window exists
+  bool reported_;             //True once the current window is reported
+  unique_ptr < WindowHistory > history_;
+
+  void init ( int argc, char** argv );
+};
+
+#endif
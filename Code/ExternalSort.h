@@ -0,0 +1,333 @@
+/**
+ *@file ExternalSort.h
+ *
+ *   Small external merge sort used when the edge structure of a
+ * window does not fit in the memory budget. Records are collected
+ * into a fixed size buffer, sorted and written to run files on disk,
+ * and later merged back into a single sorted stream.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_EXTSORT
+#define RPI_EXTSORT
+
+#include <vector>
+#include <string>
+#include <queue>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include "../../Libraries/Files/StringEx.h"
+
+using namespace std;
+
+/**
+ *@struct PairRecord
+ *
+ *   A candidate edge between two vertex ids, always stored with
+ * a < b so that each unordered pair has exactly one representation.
+ */
+struct PairRecord {
+  unsigned int a;
+  unsigned int b;
+
+  bool operator< ( const PairRecord& other ) const {
+    return ( a < other.a ) || ( ( a == other.a ) && ( b < other.b ) );
+  }
+  bool operator== ( const PairRecord& other ) const {
+    return ( a == other.a ) && ( b == other.b );
+  }
+};
+
+/**
+ *@struct EdgeStateRecord
+ *
+ *   On-disk form of an edge that carries over between windows.
+ * Files of these records are kept sorted by ( a, b ) so that the
+ * next window can merge-join against them sequentially.
+ */
+struct EdgeStateRecord {
+  unsigned int a;
+  unsigned int b;
+  double wait_time;          //Same meaning as Edge::wait_time_
+  double weight;             //Interactions in the window written
+};
+
+/**
+ *@struct EventRecord
+ *
+ *   A single simulated interaction between u and v ( u < v ). Time
+ * is absolute: the window index plus the offset inside the window.
+ * Ordered by time, then by pair, so merged streams are in global
+ * time order with a fixed order for ties.
+ */
+struct EventRecord {
+  double time;
+  unsigned int u;
+  unsigned int v;
+
+  bool operator< ( const EventRecord& other ) const {
+    if ( time != other.time ) return time < other.time;
+    return ( u < other.u ) || ( ( u == other.u ) && ( v < other.v ) );
+  }
+  bool operator== ( const EventRecord& other ) const {
+    return ( time == other.time ) && ( u == other.u ) && ( v == other.v );
+  }
+};
+
+/**
+ *@class RunReader
+ *
+ *   Buffered sequential reader over a file of fixed size records.
+ */
+template < class Record >
+class RunReader {
+ public:
+  /**
+   *@fn RunReader ( const string& filename, size_t buffer_records )
+   *
+   *@param filename Run file to read from
+   *@param buffer_records Number of records read from disk at once
+   */
+ RunReader ( const string& filename, size_t buffer_records = 4096 ): fin_ ( filename.c_str(), ios::binary ), buffer_ ( max < size_t > ( buffer_records, 1 ) ), pos_(0), end_(0){
+    if ( !fin_ ) {
+      throw runtime_error ( "Unable to open run file " + filename );
+    }
+  }
+
+  /**
+   *@fn bool next ( Record& rec )
+   *
+   *@param rec Filled with the next record of the file
+   *@return False once the end of the file has been reached
+   */
+  bool next ( Record& rec ){
+    if ( pos_ == end_ ){
+      fin_.read ( reinterpret_cast < char* > ( &buffer_[0] ), buffer_.size() * sizeof ( Record ) );
+      end_ = fin_.gcount() / sizeof ( Record );
+      pos_ = 0;
+      if ( end_ == 0 ) return false;
+    }
+    rec = buffer_[pos_++];
+    return true;
+  }
+
+ private:
+  ifstream fin_;
+  vector < Record > buffer_;
+  size_t pos_;
+  size_t end_;
+};
+
+/**
+ *@class RunWriter
+ *
+ *   Buffered sequential writer producing a file of fixed size records.
+ * Write errors ( a full disk, ... ) throw runtime_error, so a writer
+ * should be closed explicitly: the destructor closes a writer that is
+ * still open without checking, as it may run during unwinding.
+ */
+template < class Record >
+class RunWriter {
+ public:
+ RunWriter ( const string& filename, size_t buffer_records = 4096 ): filename_ ( filename ), fout_ ( filename.c_str(), ios::binary | ios::trunc ), capacity_ ( max < size_t > ( buffer_records, 1 ) ){
+    if ( !fout_ ) {
+      throw runtime_error ( "Unable to open run file " + filename );
+    }
+    buffer_.reserve ( capacity_ );
+  }
+
+  ~RunWriter(){
+    if ( fout_.is_open() ){
+      if ( !buffer_.empty() ) fout_.write ( reinterpret_cast < const char* > ( &buffer_[0] ), buffer_.size() * sizeof ( Record ) );
+      fout_.close();
+    }
+  }
+
+  void write ( const Record& rec ){
+    buffer_.push_back ( rec );
+    if ( buffer_.size() == capacity_ ) flush();
+  }
+
+  /**
+   *@fn void close ( )
+   *
+   *   Writes out the buffer and closes the file. Throws runtime_error
+   * if any record could not be written.
+   */
+  void close ( ){
+    if ( fout_.is_open() ){
+      flush();
+      fout_.close();
+      if ( fout_.fail() ) throw runtime_error ( "Unable to write run file " + filename_ );
+    }
+  }
+
+ private:
+  string filename_;
+  ofstream fout_;
+  vector < Record > buffer_;
+  size_t capacity_;
+
+  void flush ( ){
+    if ( !buffer_.empty() ){
+      fout_.write ( reinterpret_cast < const char* > ( &buffer_[0] ), buffer_.size() * sizeof ( Record ) );
+      buffer_.clear();
+      if ( !fout_ ) throw runtime_error ( "Unable to write run file " + filename_ );
+    }
+  }
+};
+
+/**
+ *@class RunSorter
+ *
+ *   Collects records into a bounded buffer. Every time the buffer
+ * fills, it is sorted, stripped of duplicates and written out as a
+ * new run. Runs are deleted when the sorter is destroyed.
+ */
+template < class Record >
+class RunSorter {
+ public:
+  /**
+   *@fn RunSorter ( const string& prefix, size_t capacity )
+   *
+   *@param prefix Path prefix for run files ( a counter is appended )
+   *@param capacity Maximum number of records held in memory
+   */
+ RunSorter ( const string& prefix, size_t capacity ): prefix_(prefix), capacity_ ( max < size_t > ( capacity, 1 ) ){
+    buffer_.reserve ( capacity_ );
+  }
+
+  ~RunSorter(){
+    for ( size_t i = 0; i < runs_.size(); i++ ){
+      remove ( runs_[i].c_str() );
+    }
+  }
+
+  void push ( const Record& rec ){
+    buffer_.push_back ( rec );
+    if ( buffer_.size() == capacity_ ) spill();
+  }
+
+  /**
+   *@fn const vector < string >& finish ( )
+   *
+   *  Writes out whatever is left in the buffer.
+   *
+   *@return Names of all run files, each sorted and duplicate free
+   */
+  const vector < string >& finish ( ){
+    spill();
+    vector < Record > ().swap ( buffer_ );
+    return runs_;
+  }
+
+ private:
+  string prefix_;
+  size_t capacity_;
+  vector < Record > buffer_;
+  vector < string > runs_;
+
+  void spill ( ){
+    if ( buffer_.empty() ) return;
+
+    sort ( buffer_.begin(), buffer_.end() );
+    buffer_.erase ( unique ( buffer_.begin(), buffer_.end() ), buffer_.end() );
+
+    runs_.push_back ( prefix_ + "." + to_str < size_t > ( runs_.size() ) );
+    RunWriter < Record > out ( runs_.back(), buffer_.size() );
+    for ( size_t i = 0; i < buffer_.size(); i++ ){
+      out.write ( buffer_[i] );
+    }
+    out.close();
+    buffer_.clear();
+  }
+};
+
+/**
+ *@class RunMerger
+ *
+ *   k-way merge over sorted run files. Equal records appearing in
+ * several runs are returned once.
+ */
+template < class Record >
+class RunMerger {
+ public:
+  /**
+   *@fn RunMerger ( const vector < string >& runs, size_t buffer_bytes )
+   *
+   *@param runs Sorted run files to merge
+   *@param buffer_bytes Read buffer shared between all runs
+   */
+ RunMerger ( const vector < string >& runs, size_t buffer_bytes ): have_last_(false) {
+    size_t per_run = buffer_bytes / ( sizeof ( Record ) * max < size_t > ( runs.size(), 1 ) );
+    for ( size_t i = 0; i < runs.size(); i++ ){
+      readers_.push_back ( shared_ptr < RunReader < Record > > ( new RunReader < Record > ( runs[i], per_run ) ) );
+      advance ( i );
+    }
+  }
+
+  /**
+   *@fn bool next ( Record& rec )
+   *
+   *@param rec Filled with the next distinct record in sorted order
+   *@return False once every run is exhausted
+   */
+  bool next ( Record& rec ){
+    while ( !heap_.empty() ){
+      Entry top = heap_.top();
+      heap_.pop();
+      advance ( top.run );
+
+      if ( have_last_ && ( top.rec == last_ ) ) continue;
+      last_ = top.rec;
+      have_last_ = true;
+      rec = top.rec;
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  struct Entry {
+    Record rec;
+    size_t run;
+    bool operator< ( const Entry& other ) const { return other.rec < rec; }
+  };
+
+  vector < shared_ptr < RunReader < Record > > > readers_;
+  priority_queue < Entry > heap_;
+  Record last_;
+  bool have_last_;
+
+  void advance ( size_t run ){
+    Entry e;
+    e.run = run;
+    if ( readers_[run]->next ( e.rec ) ){
+      heap_.push ( e );
+    }
+  }
+};
+
+#endif
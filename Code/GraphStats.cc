@@ -0,0 +1,224 @@
+/**
+ *@file GraphStats.cc
+ *
+ *   Definitions of the member functions for the GraphStats class.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GraphStats.h"
+
+template < class F >
+void GraphStats::parallelFor ( size_t n, F f ){
+  pool_.parallelFor ( 0, n, 64, [&] ( size_t lo, size_t hi ) {
+      for ( size_t i = lo; i < hi; i++ ){
+	f ( i );
+      }
+    } );
+}
+
+GraphStats::GraphStats ( Network& N, unique_ptr < Parameters >& P ): window_ ( N.getWindow() ), vertices_ ( N.NumVerts() ), edges_(0), total_weight_(0), mixing_target_ ( P->get < double > ( "mp", 0.85 ) ), mixing_realized_(0), triangles_(0), transitivity_(0), avg_clustering_(0), diameter_(0), pool_ ( N.pool() ) {
+  //Degrees are already tracked by the vertices themselves
+  const vector < shared_ptr < Vertex > >& verts = N.getVertices();
+  for ( unsigned int i = 0; i < verts.size(); i++ ){
+    ++degree_hist_[verts[i]->getEdgeCount()];
+  }
+
+  buildAdjacency ( N );
+  countTriangles();
+  estimateDiameter ( P->get < unsigned int > ( "statsbfs", 16 ), P->get < unsigned int > ( "seed", 0 ) + window_ );
+}
+
+void GraphStats::buildAdjacency ( Network& N ){
+  const vector < shared_ptr < Vertex > >& verts = N.getVertices();
+  unsigned int id_range = verts.empty() ? 0 : verts.back()->getID() + 1;
+
+  //Communities of each vertex, in increasing id order
+  vector < vector < unsigned int > > coms ( id_range );
+  N.visitCommunities ( [&] ( unsigned int id, const vset& members ) {
+      vset::const_iterator it_v;
+      for ( it_v = members.begin(); it_v != members.end(); it_v++ ){
+	coms[(*it_v)->getID()].push_back ( id );
+      }
+    } );
+
+  //Counts degrees, strengths and internal edges in one pass
+  vector < unsigned long > degree ( id_range + 1, 0 );
+  vector < double > strength ( id_range, 0 );
+  vector < pair < unsigned int, unsigned int > > pairs;
+  unsigned long internal = 0;
+
+  N.visitEdges ( [&] ( unsigned int a, unsigned int b, double w ) {
+      pairs.push_back ( make_pair ( a, b ) );
+      ++degree[a];
+      ++degree[b];
+      strength[a] += w;
+      strength[b] += w;
+      total_weight_ += w;
+
+      const vector < unsigned int >& ca = coms[a];
+      const vector < unsigned int >& cb = coms[b];
+      unsigned int i = 0, j = 0;
+      while ( ( i < ca.size() ) && ( j < cb.size() ) ){
+	if ( ca[i] == cb[j] ) { ++internal; break; }
+	if ( ca[i] < cb[j] ) ++i; else ++j;
+      }
+    } );
+  edges_ = pairs.size();
+  mixing_realized_ = ( edges_ > 0 ) ? ( double ) internal / edges_ : 0;
+
+  for ( unsigned int i = 0; i < verts.size(); i++ ){
+    double s = strength[verts[i]->getID()];
+    if ( s > 0 ) ++strength_hist_[( int ) floor ( log2 ( s ) )];
+  }
+
+  //Prefix sums of degrees give the row offsets
+  offsets_.assign ( id_range + 1, 0 );
+  for ( unsigned int i = 0; i < id_range; i++ ){
+    offsets_[i+1] = offsets_[i] + degree[i];
+  }
+  adj_.resize ( offsets_[id_range] );
+
+  vector < unsigned long > fill ( offsets_.begin(), offsets_.end() - 1 );
+  for ( unsigned long i = 0; i < pairs.size(); i++ ){
+    adj_[fill[pairs[i].first]++] = pairs[i].second;
+    adj_[fill[pairs[i].second]++] = pairs[i].first;
+  }
+
+  //Sorted neighbor lists make triangle counting a merge
+  parallelFor ( id_range, [&] ( size_t v ) {
+      sort ( adj_.begin() + offsets_[v], adj_.begin() + offsets_[v+1] );
+    } );
+}
+
+void GraphStats::countTriangles ( ){
+  size_t n = offsets_.size() - 1;
+  vector < unsigned long long > local ( n, 0 );
+
+  //Triangles through v are the edges among v's neighbors
+  parallelFor ( n, [&] ( size_t v ) {
+      unsigned long long count = 0;
+      for ( unsigned long i = offsets_[v]; i < offsets_[v+1]; i++ ){
+	unsigned int u = adj_[i];
+	unsigned long p = offsets_[v], q = offsets_[u];
+	while ( ( p < offsets_[v+1] ) && ( q < offsets_[u+1] ) ){
+	  if ( adj_[p] == adj_[q] ) { ++count; ++p; ++q; }
+	  else if ( adj_[p] < adj_[q] ) ++p;
+	  else ++q;
+	}
+      }
+      local[v] = count / 2;
+    } );
+
+  unsigned long long tri_sum = 0, triples = 0;
+  double clustering = 0;
+  unsigned long counted = 0;
+  for ( size_t v = 0; v < n; v++ ){
+    unsigned long long d = offsets_[v+1] - offsets_[v];
+    tri_sum += local[v];
+    triples += d * ( d - 1 ) / 2;
+    if ( d > 1 ){
+      clustering += ( double ) local[v] / ( d * ( d - 1 ) / 2 );
+      ++counted;
+    }
+  }
+
+  triangles_ = tri_sum / 3;
+  transitivity_ = ( triples > 0 ) ? ( double ) tri_sum / triples : 0;
+  avg_clustering_ = ( counted > 0 ) ? clustering / counted : 0;
+}
+
+unsigned int GraphStats::bfs ( unsigned int source, vector < unsigned int >& dist, unsigned int& farthest ){
+  const unsigned int unseen = ( unsigned int ) -1;
+  fill ( dist.begin(), dist.end(), unseen );
+
+  vector < unsigned int > frontier ( 1, source );
+  dist[source] = 0;
+  farthest = source;
+
+  for ( size_t head = 0; head < frontier.size(); head++ ){
+    unsigned int v = frontier[head];
+    for ( unsigned long i = offsets_[v]; i < offsets_[v+1]; i++ ){
+      if ( dist[adj_[i]] == unseen ){
+	dist[adj_[i]] = dist[v] + 1;
+	frontier.push_back ( adj_[i] );
+      }
+    }
+  }
+
+  farthest = frontier.back();
+  return dist[farthest];
+}
+
+void GraphStats::estimateDiameter ( unsigned int sources, unsigned int seed ){
+  size_t n = offsets_.size() - 1;
+
+  //Candidate sources are vertices with at least one edge
+  vector < unsigned int > active;
+  for ( size_t v = 0; v < n; v++ ){
+    if ( offsets_[v+1] > offsets_[v] ) active.push_back ( v );
+  }
+  if ( active.empty() || ( sources == 0 ) ) return;
+
+  //Each sampled source does a double sweep: BFS from the source,
+  //   then again from the farthest vertex found
+  vector < unsigned int > best ( sources, 0 );
+  parallelFor ( sources, [&] ( size_t s ) {
+      rstream rng ( streamSeed ( seed, STREAM_STATS, 0, s ) );
+      vector < unsigned int > dist ( n );
+      unsigned int far, far2;
+      bfs ( active[rng() % active.size()], dist, far );
+      best[s] = bfs ( far, dist, far2 );
+    } );
+
+  diameter_ = *max_element ( best.begin(), best.end() );
+}
+
+void GraphStats::write ( string filename ){
+  ofstream fout ( filename.c_str() );
+
+  fout << "window " << window_ << "\n";
+  fout << "vertices " << vertices_ << "\n";
+  fout << "edges " << edges_ << "\n";
+  fout << "total_weight " << total_weight_ << "\n";
+  fout << "mixing_target " << mixing_target_ << "\n";
+  fout << "mixing_realized " << mixing_realized_ << "\n";
+  fout << "triangles " << triangles_ << "\n";
+  fout << "transitivity " << transitivity_ << "\n";
+  fout << "avg_clustering " << avg_clustering_ << "\n";
+  fout << "diameter_estimate " << diameter_ << "\n";
+
+  fout << "degree_hist";
+  map < unsigned int, unsigned long >::iterator it_d;
+  for ( it_d = degree_hist_.begin(); it_d != degree_hist_.end(); it_d++ ){
+    fout << " " << it_d->first << ":" << it_d->second;
+  }
+  fout << "\n";
+
+  fout << "strength_log2_hist";
+  map < int, unsigned long >::iterator it_s;
+  for ( it_s = strength_hist_.begin(); it_s != strength_hist_.end(); it_s++ ){
+    fout << " " << it_s->first << ":" << it_s->second;
+  }
+  fout << "\n";
+
+  fout.close();
+}
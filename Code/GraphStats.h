@@ -0,0 +1,113 @@
+/**
+ *@file GraphStats.h
+ *
+ *   Per-window statistics of the generated network, computed on the
+ * in-memory edge set so that community structure, clustering and
+ * diameter can be checked without reloading the edge list.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_GSTATS
+#define RPI_GSTATS
+
+#include "Network.h"
+#include <map>
+
+using namespace std;
+
+/**
+ *@class GraphStats
+ *
+ *   Computes, for the window a network currently holds:
+ *      - degree distribution ( from Vertex::getEdgeCount )
+ *      - strength distribution ( sum of edge weights, log2 bins )
+ *      - realized mixing parameter ( share of edges inside a
+ *          community ) next to the target mp
+ *      - triangle count, transitivity and average local clustering
+ *      - a diameter estimate from BFS out of sampled sources
+ *
+ *   Triangle counting and the BFS sweeps are split over threads.
+ */
+class GraphStats {
+ public:
+  /**
+   *@fn GraphStats ( Network& N, unique_ptr < Parameters >& P )
+   *
+   *  Computes all statistics for the current window of N, using
+   * N's thread pool.
+   *
+   *@param N Network holding the window
+   *@param P Parameters ( mp, seed, statsbfs are used )
+   */
+  GraphStats ( Network& N, unique_ptr < Parameters >& P );
+
+  /**
+   *@fn void write ( string filename )
+   *
+   *  Writes the statistics as 'name value' lines, followed by the
+   * degree and strength histograms as 'value:count' lists.
+   *
+   *@param filename File to write to
+   */
+  void write ( string filename );
+
+ private:
+  int window_;
+  unsigned long vertices_;
+  unsigned long edges_;
+  double total_weight_;
+  double mixing_target_;
+  double mixing_realized_;
+  unsigned long long triangles_;
+  double transitivity_;
+  double avg_clustering_;
+  unsigned int diameter_;
+  map < unsigned int, unsigned long > degree_hist_;
+  map < int, unsigned long > strength_hist_;    //keyed by floor(log2(s))
+
+  //Adjacency in compressed sparse row form, indexed by vertex id
+  vector < unsigned long > offsets_;
+  vector < unsigned int > adj_;
+
+  ThreadPool& pool_;
+
+  /**
+   *@fn void parallelFor ( size_t n, F f )
+   *
+   *  Calls f(i) for i in [0,n) on the network's thread pool.
+   */
+  template < class F >
+  void parallelFor ( size_t n, F f );
+
+  void buildAdjacency ( Network& N );
+  void countTriangles ( );
+  void estimateDiameter ( unsigned int sources, unsigned int seed );
+
+  /**
+   *@fn unsigned int bfs ( unsigned int source, vector < unsigned int >& dist, unsigned int& farthest )
+   *
+   *@return Eccentricity of source within its component
+   */
+  unsigned int bfs ( unsigned int source, vector < unsigned int >& dist, unsigned int& farthest );
+};
+
+#endif
@@ -24,10 +24,12 @@
  */
 
 #include "Group.h"
+#include <algorithm>
+#include <iterator>
 
-Group::Group ( ) {};
+Group::Group ( MemTag tag ): members_ ( cmp_vptr(), vset::allocator_type ( tag ) ) {};
 
-Group::Group ( const Group* other ){
+Group::Group ( const Group* other ): members_ ( cmp_vptr(), other->members_.get_allocator() ) {
   //Copies over members of other group
   vset::iterator it_s;
   for ( it_s = other->members_.begin(); it_s != other->members_.end(); it_s++ ){
@@ -35,7 +37,7 @@ Group::Group ( const Group* other ){
   }
 }
 
-Group::Group ( const Group& other ) {
+Group::Group ( const Group& other ): members_ ( cmp_vptr(), other.members_.get_allocator() ) {
   //Copies over member of other group
   vset::iterator it_s;
   for ( it_s = other.members_.begin(); it_s != other.members_.end(); it_s++ ){
@@ -117,6 +119,70 @@ shared_ptr < Vertex > Group::removeRandomMember(){
   return res;
 }
 
+vector < shared_ptr < Vertex > > Group::removeRandomMembers ( unsigned int count, rstream& rng ){
+  vector < shared_ptr < Vertex > > pool ( members_.begin(), members_.end() );
+  if ( count > pool.size() ) count = pool.size();
+
+  //Partial shuffle - the first count entries are the chosen ones
+  for ( unsigned int i = 0; i < count; i++ ){
+    unsigned int j = i + ( rng() % ( pool.size() - i ) );
+    swap ( pool[i], pool[j] );
+    members_.erase ( pool[i] );
+  }
+  pool.resize ( count );
+  
+  return pool;
+}
+
+void Group::mergeMembers ( const Group& other ){
+  //Both member sets are already sorted, so the union is linear
+  vector < shared_ptr < Vertex > > merged;
+  merged.reserve ( members_.size() + other.members_.size() );
+  set_union ( members_.begin(), members_.end(), other.members_.begin(), other.members_.end(), back_inserter ( merged ), cmp_vptr() );
+
+  //Building a set from a sorted range is also linear
+  vset res ( merged.begin(), merged.end(), cmp_vptr(), members_.get_allocator() );
+  members_.swap ( res );
+}
+
+void Group::splitMembers ( Group& target, unsigned int count, double duplicate_prob, rstream& rng ){
+  vector < shared_ptr < Vertex > > flat ( members_.begin(), members_.end() );
+  if ( count > flat.size() ) count = flat.size();
+
+  //Picks count distinct positions with a partial shuffle of the
+  //   positions, and decides the fate of each one.
+  //   fate: 0 - stays, 1 - moves, 2 - moves and stays
+  vector < unsigned int > order ( flat.size() );
+  vector < char > fate ( flat.size(), 0 );
+  for ( unsigned int i = 0; i < order.size(); i++ ){
+    order[i] = i;
+  }
+  for ( unsigned int i = 0; i < count; i++ ){
+    unsigned int j = i + ( rng() % ( order.size() - i ) );
+    swap ( order[i], order[j] );
+    fate[order[i]] = ( uniform ( rng ) < duplicate_prob ) ? 2 : 1;
+  }
+
+  //One pass in sorted order partitions the members, so both
+  //   results are built from sorted ranges
+  vector < shared_ptr < Vertex > > kept, moved;
+  kept.reserve ( flat.size() );
+  moved.reserve ( count );
+  for ( unsigned int i = 0; i < flat.size(); i++ ){
+    if ( fate[i] != 0 ) moved.push_back ( flat[i] );
+    if ( fate[i] != 1 ) kept.push_back ( flat[i] );
+  }
+
+  vset res ( kept.begin(), kept.end(), cmp_vptr(), members_.get_allocator() );
+  members_.swap ( res );
+
+  vector < shared_ptr < Vertex > > joined;
+  joined.reserve ( moved.size() + target.members_.size() );
+  set_union ( target.members_.begin(), target.members_.end(), moved.begin(), moved.end(), back_inserter ( joined ), cmp_vptr() );
+  vset target_res ( joined.begin(), joined.end(), cmp_vptr(), target.members_.get_allocator() );
+  target.members_.swap ( target_res );
+}
+
 void Group::clearMembers ( ){
   members_.clear();
 }
@@ -27,23 +27,26 @@
 #define RPI_GROUP
 
 #include "Vertex.h"
+#include "RandomStream.h"
 #include <iostream>
+#include <vector>
 
 using namespace std;
 
 class Group{
  public:
   /**
-   *@fn Group()
-   *   Empty
+   *@fn Group( MemTag tag )
+   *   Empty. Member set nodes are charged to tag.
    */
-  Group();
+  Group( MemTag tag = MEM_OTHER );
 
   /**
    *@fn Group( const Group* other )
    *@fn Group( const Group& other )
    *
-   * Copy constructors. Will deep copy members of other Group
+   * Copy constructors. Will deep copy members of other Group, charged
+   * to the same tag.
    */
   Group( const Group* other );
   Group( const Group& other );
@@ -99,6 +102,18 @@ class Group{
    *@return Vertex removed
    */
   shared_ptr < Vertex > removeRandomMember();
+
+  /**
+   *@fn vector < shared_ptr < Vertex > > removeRandomMembers ( unsigned int count, rstream& rng )
+   *
+   * Removes count distinct random vertices from the group in one
+   *    pass, drawing from the given stream instead of rand().
+   *
+   *@param count Number of members to remove ( capped at size() )
+   *@param rng Random stream to draw from
+   *@return Vertices removed
+   */
+  vector < shared_ptr < Vertex > > removeRandomMembers ( unsigned int count, rstream& rng );
   
   /**
    *@fn const shared_ptr < Vertex >& getRandomMember()
@@ -109,6 +124,53 @@ class Group{
    */
   const shared_ptr < Vertex >& getRandomMember();
   
+  /**
+   *@fn void mergeMembers ( const Group& other )
+   *
+   * Adds every member of other to this group with a single linear
+   *    union of the two sorted member lists.
+   *
+   *@param other Group whose members are absorbed
+   */
+  void mergeMembers ( const Group& other );
+
+  /**
+   *@fn void splitMembers ( Group& target, unsigned int count, double duplicate_prob, rstream& rng )
+   *
+   * Moves count distinct random members into target in a single
+   *    partition pass over the sorted member list. Each moved member
+   *    also stays in this group with probability duplicate_prob.
+   *
+   *@param target Group receiving the split off members
+   *@param count Number of members to split off ( capped at size() )
+   *@param duplicate_prob Probability a moved member is kept here too
+   *@param rng Random stream to draw from
+   */
+  void splitMembers ( Group& target, unsigned int count, double duplicate_prob, rstream& rng );
+
+  /**
+   *@fn unsigned int removeMembersIf ( F pred )
+   *
+   * Removes every member for which pred returns true.
+   *
+   *@param pred Callable taking a const shared_ptr < Vertex >&
+   *@return Number of members removed
+   */
+  template < class F >
+  unsigned int removeMembersIf ( F pred ){
+    unsigned int removed = 0;
+    vset::iterator it_m = members_.begin();
+    while ( it_m != members_.end() ){
+      if ( pred ( *it_m ) ){
+	members_.erase ( it_m++ );
+	++removed;
+      } else {
+	++it_m;
+      }
+    }
+    return removed;
+  }
+
   /**
    *@fn void clearMembers ( )
    *
@@ -0,0 +1,97 @@
+/**
+ *@file Hyperedge.cc
+ *
+ *   Definitions for the flat storage of interaction groups.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Hyperedge.h"
+#include "../../Libraries/Files/StringEx.h"
+
+/**
+ *@fn void appendId ( string& out, uint32_t id )
+ *
+ *   Writes id in decimal at the end of out.
+ */
+static void appendId ( string& out, uint32_t id ){
+  char digits[10];
+  int n = 0;
+  do {
+    digits[n++] = '0' + ( id % 10 );
+    id /= 10;
+  } while ( id > 0 );
+  while ( n > 0 ) out += digits[--n];
+}
+
+HyperedgeSet::HyperedgeSet ( ): offsets_ ( 1, 0, TrackedAllocator < uint64_t > ( MEM_EDGES ) ), members_ ( TrackedAllocator < uint32_t > ( MEM_EDGES ) ), weights_ ( TrackedAllocator < double > ( MEM_EDGES ) ) { }
+
+void HyperedgeSet::clear ( ){
+  offsets_.resize ( 1 );
+  members_.clear();
+  weights_.clear();
+}
+
+void HyperedgeSet::add ( const uint32_t* ids, unsigned int count, double weight ){
+  members_.insert ( members_.end(), ids, ids + count );
+  offsets_.push_back ( members_.size() );
+  weights_.push_back ( weight );
+}
+
+void HyperedgeSet::append ( const HyperedgeSet& other ){
+  uint64_t base = members_.size();
+  members_.insert ( members_.end(), other.members_.begin(), other.members_.end() );
+  for ( size_t h = 1; h < other.offsets_.size(); h++ ){
+    offsets_.push_back ( base + other.offsets_[h] );
+  }
+  weights_.insert ( weights_.end(), other.weights_.begin(), other.weights_.end() );
+}
+
+void HyperedgeSet::format ( size_t lo, size_t hi, Output mode, string& out ) const {
+  for ( size_t h = lo; h < hi; h++ ){
+    if ( weights_[h] <= 0 ) continue;
+
+    string weight = to_str < double > ( weights_[h] );
+    const uint32_t* ids = members ( h );
+    unsigned int k = arity ( h );
+
+    if ( mode == OUT_NATIVE ){
+      for ( unsigned int i = 0; i < k; i++ ){
+	appendId ( out, ids[i] );
+	out += '|';
+      }
+      out += weight;
+      out += '\n';
+      continue;
+    }
+
+    for ( unsigned int i = 0; i < k; i++ ){
+      for ( unsigned int j = i + 1; j < k; j++ ){
+	appendId ( out, ids[i] );
+	out += '|';
+	appendId ( out, ids[j] );
+	out += '|';
+	out += weight;
+	out += '\n';
+      }
+    }
+  }
+}
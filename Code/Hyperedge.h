@@ -0,0 +1,118 @@
+/**
+ *@file Hyperedge.h
+ *
+ *   Compact storage for interaction groups of more than two members
+ * ( -hyper ). An Edge can hold any number of members, but each one
+ * carries a member set of its own and toString expands it into
+ * pairs with one string per pair. A HyperedgeSet instead keeps all
+ * groups of a window in three flat arrays: member ids back to back,
+ * the offset where each group starts, and each group's weight.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_HYPEREDGE
+#define RPI_HYPEREDGE
+
+#include "MemoryAccount.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ *@class HyperedgeSet
+ *
+ *   Groups of one window, in the order they were added. Group h has
+ * the arity(h) ids starting at members(h), in increasing order.
+ * Storage is charged to MEM_EDGES.
+ */
+class HyperedgeSet {
+ public:
+  /**
+   *@enum Output
+   *
+   *   Formats a group can be written in.
+   */
+  enum Output {
+    OUT_NATIVE,      //One 'a|b|...|weight' line per group
+    OUT_CLIQUE       //One 'a|b|weight' line per pair of members
+  };
+
+  HyperedgeSet ( );
+
+  /**
+   *@fn static const char* const* outputNames ( )
+   *
+   *@return Names of the Output values, as given to -hyperout
+   */
+  static const char* const* outputNames ( ){
+    static const char* const res[] = { "native", "clique" };
+    return res;
+  }
+
+  /**
+   *@fn void clear ( )
+   *
+   *   Drops all groups, keeping the storage for the next window.
+   */
+  void clear ( );
+
+  /**
+   *@fn void add ( const uint32_t* ids, unsigned int count, double weight )
+   *
+   *@param ids Members of the group, in increasing order
+   *@param count Number of members
+   *@param weight Interactions of the group in the window
+   */
+  void add ( const uint32_t* ids, unsigned int count, double weight );
+
+  /**
+   *@fn void append ( const HyperedgeSet& other )
+   *
+   *   Adds all groups of other, in order, after the ones held.
+   */
+  void append ( const HyperedgeSet& other );
+
+  size_t size ( ) const { return offsets_.size() - 1; }
+  size_t numMembers ( ) const { return members_.size(); }
+
+  unsigned int arity ( size_t h ) const { return offsets_[h+1] - offsets_[h]; }
+  const uint32_t* members ( size_t h ) const { return &members_[offsets_[h]]; }
+  double weight ( size_t h ) const { return weights_[h]; }
+
+  /**
+   *@fn void format ( size_t lo, size_t hi, Output mode, string& out ) const
+   *
+   *   Appends the lines of groups lo to hi - 1 with a positive weight
+   * to out. Ids are written straight into out, and each weight is
+   * formatted once per group, however many pairs it expands to.
+   */
+  void format ( size_t lo, size_t hi, Output mode, string& out ) const;
+
+ private:
+  vector < uint64_t, TrackedAllocator < uint64_t > > offsets_;  //Start of each group, and the end
+  vector < uint32_t, TrackedAllocator < uint32_t > > members_;  //Ids of all groups
+  vector < double, TrackedAllocator < double > > weights_;      //Weight of each group
+};
+
+#endif
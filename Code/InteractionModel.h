@@ -0,0 +1,302 @@
+/**
+ *@file InteractionModel.h
+ *
+ *   Policies for the parts of the model that are meant to be swapped:
+ * how member energies map to an edge's lag, how wait times between
+ * interactions are distributed, and how community sizes are drawn.
+ *
+ *   Every combination is compiled in. The model is picked once at
+ * startup ( -lagmodel, -waitmodel, -sizemodel ) and a group switches
+ * into the matching instantiation of interactions before its
+ * interaction loop ( simulateWindow ), so the loop itself makes only
+ * direct, inlinable calls.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_INTERACTION
+#define RPI_INTERACTION
+
+#include "Vertex.h"
+#include "LagSamplerCache.h"
+#include "InversePowerLaw.h"
+#include "../../Libraries/Random/PowerLaw.h"
+#include "../../Libraries/Random/Wrappers.h"
+#include "../../Libraries/Params/Parameters.h"
+#include <cmath>
+#include <memory>
+
+using namespace std;
+
+/**
+ *   Lag policies. A member's own lag is ( max_energy - energy ) +
+ * minlag, so high energy vertices interact often; the policy combines
+ * the members' lags into the edge's lag, reading the settings it needs
+ * from the cache. Members is any container of vertex pointers in id
+ * order ( a vset, or the member array of a hyperedge ).
+ */
+
+/**
+ *@struct GravityLag
+ *
+ *   The original model: starts from the largest member lag and pulls
+ * it toward each other member's lag by gravity. A high lag - low lag
+ * edge thus interacts more than an edge of two high lag vertices.
+ */
+struct GravityLag {
+  template < class Members >
+  static double lag ( const Members& members, const LagSamplerCache& cache ){
+    double gravity = cache.gravity(), minlag = cache.minlag(), max_energy = cache.maxEnergy();
+    double res = -1;
+    typename Members::const_iterator it_v;
+    for ( it_v = members.begin(); it_v != members.end(); it_v++ ){
+      double v_lag = ( max_energy - (*it_v)->getEnergy() ) + minlag;
+      if ( v_lag > res ) res = v_lag;
+    }
+
+    //Every member but the ( first ) one with the largest lag pulls
+    double max_res = res;
+    bool considered = false;
+    for ( it_v = members.begin(); it_v != members.end(); it_v++ ){
+      double v_lag = ( max_energy - (*it_v)->getEnergy() ) + minlag;
+      if ( ( v_lag == max_res ) && ( !considered ) ){
+	considered = true;
+      } else {
+	res -= ( gravity * ( res - v_lag ) );
+      }
+    }
+
+    return res;
+  }
+};
+
+/**
+ *@struct MeanLag
+ *
+ *   Average of the member lags.
+ */
+struct MeanLag {
+  template < class Members >
+  static double lag ( const Members& members, const LagSamplerCache& cache ){
+    double minlag = cache.minlag(), max_energy = cache.maxEnergy();
+    double sum = 0;
+    typename Members::const_iterator it_v;
+    for ( it_v = members.begin(); it_v != members.end(); it_v++ ){
+      sum += ( max_energy - (*it_v)->getEnergy() ) + minlag;
+    }
+    return members.empty() ? minlag : sum / members.size();
+  }
+};
+
+/**
+ *@struct MinLag
+ *
+ *   The most active member sets the pace.
+ */
+struct MinLag {
+  template < class Members >
+  static double lag ( const Members& members, const LagSamplerCache& cache ){
+    double minlag = cache.minlag(), max_energy = cache.maxEnergy();
+    double res = max_energy + minlag;
+    typename Members::const_iterator it_v;
+    for ( it_v = members.begin(); it_v != members.end(); it_v++ ){
+      res = min ( res, ( max_energy - (*it_v)->getEnergy() ) + minlag );
+    }
+    return res;
+  }
+};
+
+/**
+ *   Wait time policies. One is built per edge and window from the
+ * edge's lag, then maps uniforms in [0,1) to wait times.
+ */
+
+/**
+ *@class PowerLawWait
+ *
+ *   Power law wait times on [lag, waitcap] with exponent waitexp
+ * ( the original model ). Uses the cache's sampler for the lag when
+ * there is one.
+ */
+class PowerLawWait {
+ public:
+  PowerLawWait ( const LagSamplerCache& cache, double lag ): sampler_ ( cache.lookup ( lag ) ) {
+    if ( !sampler_ ){
+      exact_ = InversePowerLaw ( cache.waitExponent(), lag, cache.waitCap() );
+      sampler_ = &exact_;
+    }
+  }
+
+  double operator() ( double u ) const { return (*sampler_) ( u ); }
+
+ private:
+  const InversePowerLaw* sampler_;
+  InversePowerLaw exact_;
+
+  PowerLawWait ( const PowerLawWait& );
+  PowerLawWait& operator= ( const PowerLawWait& );
+};
+
+/**
+ *@class ExponentialWait
+ *
+ *   Exponential wait times with mean lag: interactions of an edge
+ * form a Poisson process.
+ */
+class ExponentialWait {
+ public:
+  ExponentialWait ( const LagSamplerCache&, double lag ): mean_ ( lag ) { }
+
+  double operator() ( double u ) const { return -mean_ * log ( 1.0 - u ); }
+
+ private:
+  double mean_;
+};
+
+/**
+ *@fn double interactions ( const LagSamplerCache& cache, const Members& members, double& wait_time, Draw& draw, Record& record )
+ *
+ *   The interaction loop of one group for one lag and wait time
+ * policy. wait_time is the time of the group's next interaction; it
+ * is advanced past the end of the window and carried over.
+ *
+ *@param draw Callable returning the next uniform in [0,1)
+ *@param record Callable taking the time of each interaction inside
+ *              the window
+ *@return Number of interactions in the window
+ */
+template < class Lag, class Wait, class Members, class Draw, class Record >
+double interactions ( const LagSamplerCache& cache, const Members& members, double& wait_time, Draw& draw, Record& record ){
+  //Sets up the wait time distribution for the group - it depends on
+  //  the energies of the members and so may differ between windows
+  Wait wait ( cache, Lag::lag ( members, cache ) );
+  double weight = 0;
+
+  //wait_time represents the time at which the next interaction 
+  //   between members will happen ( sorry for the slight 
+  //   misnomer ). If wait_time is 0.27, it means that the next
+  //   interaction will happen 0.27 time units into a time window
+  //   [0, 1)
+  while ( wait_time < 1.0 ){
+    record ( wait_time );
+    wait_time += wait ( draw() );
+    ++weight;
+  }
+
+  //Track that the time window has passed
+  wait_time -= 1.0;
+  return weight;
+}
+
+/**
+ *@fn double simulateWindow ( const LagSamplerCache& cache, const Members& members, double& wait_time, Draw& draw, Record record )
+ *
+ *   Switches on the interaction model held by cache to the matching
+ * instantiation of interactions. One branch per group picks the
+ * model; the loop inside is fixed.
+ */
+template < class Members, class Draw, class Record >
+double simulateWindow ( const LagSamplerCache& cache, const Members& members, double& wait_time, Draw& draw, Record record ){
+  switch ( cache.lagModel() * LagSamplerCache::WAIT_MODELS + cache.waitModel() ){
+  case LagSamplerCache::LAG_MEAN * LagSamplerCache::WAIT_MODELS + LagSamplerCache::WAIT_POWERLAW:
+    return interactions < MeanLag, PowerLawWait > ( cache, members, wait_time, draw, record );
+  case LagSamplerCache::LAG_MIN * LagSamplerCache::WAIT_MODELS + LagSamplerCache::WAIT_POWERLAW:
+    return interactions < MinLag, PowerLawWait > ( cache, members, wait_time, draw, record );
+  case LagSamplerCache::LAG_GRAVITY * LagSamplerCache::WAIT_MODELS + LagSamplerCache::WAIT_EXPONENTIAL:
+    return interactions < GravityLag, ExponentialWait > ( cache, members, wait_time, draw, record );
+  case LagSamplerCache::LAG_MEAN * LagSamplerCache::WAIT_MODELS + LagSamplerCache::WAIT_EXPONENTIAL:
+    return interactions < MeanLag, ExponentialWait > ( cache, members, wait_time, draw, record );
+  case LagSamplerCache::LAG_MIN * LagSamplerCache::WAIT_MODELS + LagSamplerCache::WAIT_EXPONENTIAL:
+    return interactions < MinLag, ExponentialWait > ( cache, members, wait_time, draw, record );
+  default:
+    return interactions < GravityLag, PowerLawWait > ( cache, members, wait_time, draw, record );
+  }
+}
+
+/**
+ *   Community size policies, drawn whenever a community is created.
+ */
+
+/**
+ *@class PowerLawSize
+ *
+ *   Power law sizes with exponent -cexp on [cmin, cmax] ( the
+ * original model ).
+ */
+class PowerLawSize {
+ public:
+  PowerLawSize ( unique_ptr < Parameters >& P ): pl_ ( -P->get < double > ( "cexp", 2.75 ), P->get < double > ( "cmin", 3 ), P->get < double > ( "cmax", 55 ) ) { }
+
+  unsigned int operator() ( ) { return pl_.Sample(); }
+
+ private:
+  PowerLaw pl_;
+};
+
+/**
+ *@class UniformSize
+ *
+ *   Sizes uniform over the integers in [cmin, cmax].
+ */
+class UniformSize {
+ public:
+  UniformSize ( unique_ptr < Parameters >& P ): min_ ( P->get < int > ( "cmin", 3 ) ), max_ ( P->get < int > ( "cmax", 55 ) ) { }
+
+  unsigned int operator() ( ) { return random_int ( min_, max_ ); }
+
+ private:
+  int min_;
+  int max_;
+};
+
+/**
+ *@class CommunitySizes
+ *
+ *   Holds the size policy chosen with -sizemodel ( powerlaw, the
+ * default, or uniform ).
+ */
+class CommunitySizes {
+ public:
+  enum Model { SIZE_POWERLAW, SIZE_UNIFORM };
+
+  /**
+   *@fn CommunitySizes ( unique_ptr < Parameters >& P )
+   *
+   *   Throws runtime_error for an unknown -sizemodel.
+   */
+  CommunitySizes ( unique_ptr < Parameters >& P ): model_ ( ( Model ) LagSamplerCache::modelIndex ( P, "sizemodel", names(), 2 ) ), powerlaw_ ( P ), uniform_ ( P ) { }
+
+  unsigned int operator() ( ) {
+    return ( model_ == SIZE_UNIFORM ) ? uniform_() : powerlaw_();
+  }
+
+ private:
+  static const char* const* names ( ){
+    static const char* const res[] = { "powerlaw", "uniform" };
+    return res;
+  }
+
+  Model model_;
+  PowerLawSize powerlaw_;
+  UniformSize uniform_;
+};
+
+#endif
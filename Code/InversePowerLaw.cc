@@ -0,0 +1,43 @@
+/**
+ *@file InversePowerLaw.cc
+ *
+ *   Batch kernel of the InversePowerLaw class. Built with -O3
+ * -ffast-math ( see makefile ); keep anything that must match scalar
+ * results bit for bit out of this file.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "InversePowerLaw.h"
+
+void InversePowerLaw::transform ( const double* uniforms, double* out, size_t n ) const {
+  //Members copied to locals so the loops carry no loads through this
+  const double base = base_, span = span_, inv_exp = inv_exp_;
+  if ( log_form_ ){
+    for ( size_t i = 0; i < n; i++ ){
+      out[i] = exp ( base + uniforms[i] * span );
+    }
+  } else {
+    for ( size_t i = 0; i < n; i++ ){
+      out[i] = exp ( inv_exp * log ( base + uniforms[i] * span ) );
+    }
+  }
+}
@@ -0,0 +1,100 @@
+/**
+ *@file InversePowerLaw.h
+ *
+ *   Inverse-CDF sampling for a power law truncated to [xmin, xmax].
+ * All of the setup ( pow calls and normalisation ) happens once in
+ * the constructor, so a single object can be reused for any number
+ * of draws and for whole arrays of draws at once.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_INVPL
+#define RPI_INVPL
+
+#include <cmath>
+#include <cstddef>
+
+/**
+ *@class InversePowerLaw
+ *
+ *   For p(x) ~ x^exp on [xmin, xmax] the inverse of the CDF is
+ *
+ *      x(u) = ( xmin^(exp+1) + u * ( xmax^(exp+1) - xmin^(exp+1) ) )^(1/(exp+1))
+ *
+ * and for exp == -1 it is x(u) = xmin * ( xmax / xmin )^u.
+ */
+class InversePowerLaw {
+ public:
+  /**
+   *@fn InversePowerLaw ( double exponent, double xmin, double xmax )
+   *
+   *@param exponent Exponent of the power law ( negative for decay )
+   *@param xmin Smallest value that can be drawn
+   *@param xmax Largest value that can be drawn
+   */
+  InversePowerLaw ( double exponent = -1.75, double xmin = 1, double xmax = 2 ){
+    double b = exponent + 1;
+    log_form_ = ( fabs ( b ) < 1e-12 );
+    if ( log_form_ ){
+      base_ = log ( xmin );
+      span_ = log ( xmax ) - base_;
+      inv_exp_ = 1;
+    } else {
+      base_ = pow ( xmin, b );
+      span_ = pow ( xmax, b ) - base_;
+      inv_exp_ = 1.0 / b;
+    }
+  }
+
+  /**
+   *@fn double operator() ( double u ) const
+   *
+   *@param u Uniform value in [0,1)
+   *@return Corresponding power law value
+   */
+  double operator() ( double u ) const {
+    if ( log_form_ ) return exp ( base_ + u * span_ );
+    return exp ( inv_exp_ * log ( base_ + u * span_ ) );
+  }
+
+  /**
+   *@fn void transform ( const double* uniforms, double* out, size_t n ) const
+   *
+   *   Maps n uniforms to power law values. Defined in its own
+   * translation unit, which the makefile builds with -O3 -ffast-math
+   * whatever FLAGS holds, so the loops are vectorized with libmvec's
+   * exp and log. Results may differ from operator() in the last bits.
+   *
+   *@param uniforms Array of n values in [0,1)
+   *@param out Array receiving the n samples ( may alias uniforms )
+   *@param n Number of samples
+   */
+  void transform ( const double* uniforms, double* out, size_t n ) const;
+
+ private:
+  double base_;        //xmin^(exp+1)  ( log xmin for exp == -1 )
+  double span_;        //xmax^(exp+1) - xmin^(exp+1)
+  double inv_exp_;     //1 / (exp+1)
+  bool log_form_;      //True for exp == -1
+};
+
+#endif
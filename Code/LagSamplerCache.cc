@@ -0,0 +1,63 @@
+/**
+ *@file LagSamplerCache.cc
+ *
+ *   Definitions of the member functions for the LagSamplerCache class.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LagSamplerCache.h"
+#include <stdexcept>
+
+const double LagSamplerCache::WAIT_EXP = -1.75;
+const double LagSamplerCache::WAIT_CAP = 3.0;
+
+static const char* const LAG_NAMES[] = { "gravity", "mean", "min" };
+static const char* const WAIT_NAMES[] = { "powerlaw", "exp" };
+
+LagSamplerCache::LagSamplerCache ( unique_ptr < Parameters >& P ): gravity_ ( P->get < double > ( "grav", 0.2 ) ), minlag_ ( P->get < double > ( "minlag", 0.2 ) ), max_energy_ ( P->get < double > ( "vmax", 1 ) ), wait_exp_ ( P->get < double > ( "waitexp", WAIT_EXP ) ), wait_cap_ ( P->get < double > ( "waitcap", WAIT_CAP ) ), lag_model_ ( ( LagModel ) modelIndex ( P, "lagmodel", LAG_NAMES, LAG_MODELS ) ), wait_model_ ( ( WaitModel ) modelIndex ( P, "waitmodel", WAIT_NAMES, WAIT_MODELS ) ), min_energy_ ( P->get < double > ( "vmin", 0.4 ) ), step_ ( P->get < double > ( "lagq", 0 ) ), low_(0), inv_step_(0) {
+  if ( ( step_ <= 0 ) || ( wait_model_ != WAIT_POWERLAW ) ) return;
+
+  //Grid over every lag the model's energies can produce
+  low_ = minlag_;
+  double high = ( max_energy_ - min_energy_ ) + minlag_;
+  inv_step_ = 1.0 / step_;
+
+  size_t points = ( size_t ) ( ( high - low_ ) * inv_step_ ) + 2;
+  table_.reserve ( points );
+  for ( size_t i = 0; i < points; i++ ){
+    table_.push_back ( InversePowerLaw ( wait_exp_, low_ + i * step_, wait_cap_ ) );
+  }
+}
+
+bool LagSamplerCache::current ( unique_ptr < Parameters >& P ) const {
+  return ( gravity_ == P->get < double > ( "grav", 0.2 ) ) && ( minlag_ == P->get < double > ( "minlag", 0.2 ) ) && ( max_energy_ == P->get < double > ( "vmax", 1 ) ) && ( min_energy_ == P->get < double > ( "vmin", 0.4 ) ) && ( wait_exp_ == P->get < double > ( "waitexp", WAIT_EXP ) ) && ( wait_cap_ == P->get < double > ( "waitcap", WAIT_CAP ) ) && ( step_ == P->get < double > ( "lagq", 0 ) ) && ( lag_model_ == ( LagModel ) modelIndex ( P, "lagmodel", LAG_NAMES, LAG_MODELS ) ) && ( wait_model_ == ( WaitModel ) modelIndex ( P, "waitmodel", WAIT_NAMES, WAIT_MODELS ) );
+}
+
+unsigned int LagSamplerCache::modelIndex ( unique_ptr < Parameters >& P, const string& key, const char* const* names, unsigned int count ){
+  if ( !P->hasFlag ( key ) ) return 0;
+
+  string value = P->get < string > ( key );
+  for ( unsigned int i = 0; i < count; i++ ){
+    if ( value == names[i] ) return i;
+  }
+  throw runtime_error ( "Unknown " + key + " '" + value + "'" );
+}
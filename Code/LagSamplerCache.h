@@ -0,0 +1,145 @@
+/**
+ *@file LagSamplerCache.h
+ *
+ *   Cache of the wait-time power laws used by Edge::generateWeight,
+ * keyed by quantized lag. Each Network owns one.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_LAGCACHE
+#define RPI_LAGCACHE
+
+#include "InversePowerLaw.h"
+#include "../../Libraries/Params/Parameters.h"
+#include <vector>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+/**
+ *@class LagSamplerCache
+ *
+ *   The wait time power law of an edge only depends on its lag,
+ * which is a fixed function of the members' energies. Energies lie
+ * in [vmin, vmax], so every lag lies in
+ *
+ *      [ minlag, vmax - vmin + minlag ]
+ *
+ * With -lagq q > 0, that range is cut into a grid of spacing q and
+ * the inverse-CDF constants of each grid point are computed once, up
+ * front, and shared by every edge in every window. An edge's lag is
+ * snapped to the nearest grid point.
+ *
+ *   Quantization error: samples are drawn exactly from the power law
+ * whose lower cutoff lag' satisfies |lag' - lag| <= q/2. The sample
+ * for a given uniform u moves by at most
+ *
+ *      (q/2) * (1-u) * ( x(u) / lag )^1.75
+ *
+ * and the mean wait time moves by under 0.2% for q = 1e-3 when
+ * lag >= 0.2 ( the error scales linearly with q ). Lags outside the
+ * grid ( e.g. energies not drawn from the model ) fall back to an
+ * exact sampler.
+ *
+ *   With q = 0 ( the default ) edges keep building their own exact
+ * PowerLaw, but the parameter lookups are still done only once.
+ *
+ *   The cache also holds the interaction model chosen on the command
+ * line ( see InteractionModel.h ). The grid is only built for power
+ * law wait times.
+ */
+class LagSamplerCache {
+ public:
+  static const double WAIT_EXP;    //Default exponent of the wait time power law
+  static const double WAIT_CAP;    //Default longest possible wait time
+
+  enum LagModel { LAG_GRAVITY, LAG_MEAN, LAG_MIN, LAG_MODELS };
+  enum WaitModel { WAIT_POWERLAW, WAIT_EXPONENTIAL, WAIT_MODELS };
+
+  /**
+   *@fn LagSamplerCache ( unique_ptr < Parameters >& P )
+   *
+   *   Throws runtime_error for an unknown -lagmodel or -waitmodel.
+   *
+   *@param P Parameters ( grav, minlag, vmin, vmax, lagq, lagmodel,
+   *          waitmodel, waitexp and waitcap are used )
+   */
+  LagSamplerCache ( unique_ptr < Parameters >& P );
+
+  /**
+   *@fn bool current ( unique_ptr < Parameters >& P ) const
+   *
+   *@return True if P still holds the values the cache was built
+   *         from, so it can be kept for another window
+   */
+  bool current ( unique_ptr < Parameters >& P ) const;
+
+  /**
+   *@fn const InversePowerLaw* lookup ( double lag ) const
+   *
+   *@param lag Lag of an edge ( see Edge::getTotalEnergy )
+   *@return Sampler for the nearest grid point, or NULL if the cache
+   *         is disabled or the lag is off the grid
+   */
+  const InversePowerLaw* lookup ( double lag ) const {
+    if ( table_.empty() ) return NULL;
+
+    double pos = ( lag - low_ ) * inv_step_ + 0.5;
+    if ( ( pos < 0 ) || ( pos >= table_.size() ) ) return NULL;
+    return &table_[( size_t ) pos];
+  }
+
+  double gravity ( ) const { return gravity_; }
+  double minlag ( ) const { return minlag_; }
+  double maxEnergy ( ) const { return max_energy_; }
+  double waitExponent ( ) const { return wait_exp_; }
+  double waitCap ( ) const { return wait_cap_; }
+  LagModel lagModel ( ) const { return lag_model_; }
+  WaitModel waitModel ( ) const { return wait_model_; }
+
+  /**
+   *@fn static unsigned int modelIndex ( unique_ptr < Parameters >& P, const string& key, const char* const* names, unsigned int count )
+   *
+   *   Looks up the value of parameter key in names. Throws
+   * runtime_error if it is not one of them.
+   *
+   *@return Position of the value in names, 0 if key is not given
+   */
+  static unsigned int modelIndex ( unique_ptr < Parameters >& P, const string& key, const char* const* names, unsigned int count );
+
+ private:
+  double gravity_;
+  double minlag_;
+  double max_energy_;
+  double wait_exp_;
+  double wait_cap_;
+  LagModel lag_model_;
+  WaitModel wait_model_;
+  double min_energy_;
+  double step_;                      //Grid spacing q ( lagq )
+  double low_;                       //Lag of the first grid point
+  double inv_step_;                  //1 / q
+  vector < InversePowerLaw > table_; //One sampler per grid point
+};
+
+#endif
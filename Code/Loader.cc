@@ -0,0 +1,258 @@
+/**
+ *@file Loader.cc
+ *
+ *   Definitions for memory-mapped, parallel loading of networks.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Loader.h"
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile ( const string& filename ): data_(NULL), size_(0) {
+  int fd = open ( filename.c_str(), O_RDONLY );
+  if ( fd < 0 ){
+    throw runtime_error ( "Unable to open " + filename );
+  }
+
+  struct stat info;
+  if ( fstat ( fd, &info ) != 0 ){
+    close ( fd );
+    throw runtime_error ( "Unable to stat " + filename );
+  }
+  size_ = info.st_size;
+
+  //Empty files cannot be mapped, but are valid input
+  if ( size_ > 0 ){
+    void* res = mmap ( NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( res == MAP_FAILED ){
+      close ( fd );
+      throw runtime_error ( "Unable to map " + filename );
+    }
+    madvise ( res, size_, MADV_SEQUENTIAL );
+    data_ = static_cast < const char* > ( res );
+  }
+  close ( fd );
+}
+
+MappedFile::~MappedFile ( ){
+  if ( data_ ) munmap ( const_cast < char* > ( data_ ), size_ );
+}
+
+/**
+ *@fn vector < size_t > lineChunks ( const MappedFile& file, size_t chunks )
+ *
+ *   Cuts the file into roughly equal pieces that each start at the
+ * beginning of a line.
+ *
+ *@return chunks + 1 boundaries ( some pieces may be empty )
+ */
+static vector < size_t > lineChunks ( const MappedFile& file, size_t chunks ){
+  vector < size_t > bounds ( chunks + 1, file.size() );
+  bounds[0] = 0;
+
+  for ( size_t i = 1; i < chunks; i++ ){
+    size_t pos = max ( bounds[i-1], file.size() / chunks * i );
+    while ( ( pos < file.size() ) && ( pos > 0 ) && ( file.data()[pos-1] != '\n' ) ){
+      ++pos;
+    }
+    bounds[i] = pos;
+  }
+
+  return bounds;
+}
+
+/**
+ *@fn bool readNumber ( const char*& p, const char* end, double& value )
+ *
+ *   Skips separators ( anything that cannot start a number ) up to
+ * the end of the line, then parses a number.
+ *
+ *@return False if the line ended before a number was found
+ */
+static bool readNumber ( const char*& p, const char* end, double& value ){
+  while ( ( p < end ) && ( *p != '\n' ) && !( ( ( *p >= '0' ) && ( *p <= '9' ) ) || ( *p == '.' ) || ( *p == '-' ) ) ){
+    ++p;
+  }
+  if ( ( p == end ) || ( *p == '\n' ) ) return false;
+
+  //strtod needs a terminated string; numbers are short, so copy
+  char buf[64];
+  size_t len = 0;
+  while ( ( p < end ) && ( len < sizeof ( buf ) - 1 ) && ( ( ( *p >= '0' ) && ( *p <= '9' ) ) || ( *p == '.' ) || ( *p == '-' ) || ( *p == '+' ) || ( *p == 'e' ) || ( *p == 'E' ) ) ){
+    buf[len++] = *p++;
+  }
+  buf[len] = '\0';
+  value = strtod ( buf, NULL );
+  return true;
+}
+
+/**
+ *@fn bool parseEdgeLine ( const char*& p, const char* end, BinaryEdgeRecord& rec )
+ *
+ *   Parses the 'a|b|weight' line starting at p and moves p to the
+ * start of the next line.
+ *
+ *@return False if the line holds no edge
+ */
+static bool parseEdgeLine ( const char*& p, const char* end, BinaryEdgeRecord& rec ){
+  double a, b, w;
+  bool res = readNumber ( p, end, a ) && readNumber ( p, end, b );
+  if ( res ){
+    rec.a = ( unsigned int ) a;
+    rec.b = ( unsigned int ) b;
+    rec.weight = readNumber ( p, end, w ) ? w : 1;
+  }
+
+  //Moves on to the next line
+  while ( ( p < end ) && ( *p != '\n' ) ) ++p;
+  ++p;
+  return res;
+}
+
+bool EdgeListReader::next ( BinaryEdgeRecord& rec ){
+  const char* end = file_.data() + file_.size();
+  while ( pos_ < end ){
+    if ( parseEdgeLine ( pos_, end, rec ) ) return true;
+  }
+  return false;
+}
+
+vector < BinaryEdgeRecord > loadEdgeList ( const string& filename, bool binary, ThreadPool& pool ){
+  MappedFile file ( filename );
+  vector < BinaryEdgeRecord > res;
+
+  //Binary files are already in the right layout
+  if ( binary ){
+    size_t count = file.size() / sizeof ( BinaryEdgeRecord );
+    res.resize ( count );
+    if ( count > 0 ) memcpy ( &res[0], file.data(), count * sizeof ( BinaryEdgeRecord ) );
+    return res;
+  }
+
+  //Each chunk is parsed into its own list, then lists are joined
+  size_t chunks = pool.size() * 4;
+  vector < size_t > bounds = lineChunks ( file, chunks );
+  vector < vector < BinaryEdgeRecord > > parts ( chunks );
+
+  pool.parallelFor ( 0, chunks, 1, [&] ( size_t lo, size_t hi ) {
+      for ( size_t c = lo; c < hi; c++ ){
+	const char* p = file.data() + bounds[c];
+	const char* end = file.data() + bounds[c+1];
+
+	BinaryEdgeRecord rec;
+	while ( p < end ){
+	  if ( parseEdgeLine ( p, end, rec ) ) parts[c].push_back ( rec );
+	}
+      }
+    } );
+
+  size_t total = 0;
+  for ( size_t c = 0; c < chunks; c++ ) total += parts[c].size();
+  res.reserve ( total );
+  for ( size_t c = 0; c < chunks; c++ ){
+    res.insert ( res.end(), parts[c].begin(), parts[c].end() );
+    vector < BinaryEdgeRecord > ().swap ( parts[c] );
+  }
+
+  return res;
+}
+
+vector < vector < unsigned int > > loadCommunities ( const string& filename, ThreadPool& pool ){
+  MappedFile file ( filename );
+
+  size_t chunks = pool.size() * 4;
+  vector < size_t > bounds = lineChunks ( file, chunks );
+  vector < vector < vector < unsigned int > > > parts ( chunks );
+
+  pool.parallelFor ( 0, chunks, 1, [&] ( size_t lo, size_t hi ) {
+      for ( size_t c = lo; c < hi; c++ ){
+	const char* p = file.data() + bounds[c];
+	const char* end = file.data() + bounds[c+1];
+
+	while ( p < end ){
+	  const char* eol = p;
+	  while ( ( eol < end ) && ( *eol != '\n' ) ) ++eol;
+
+	  //Members start after '(' when the line has a leading id
+	  const char* open_paren = static_cast < const char* > ( memchr ( p, '(', eol - p ) );
+	  if ( open_paren ) p = open_paren + 1;
+
+	  vector < unsigned int > members;
+	  double v;
+	  while ( readNumber ( p, eol, v ) ){
+	    members.push_back ( ( unsigned int ) v );
+	  }
+	  if ( !members.empty() ) parts[c].push_back ( members );
+
+	  p = eol + 1;
+	}
+      }
+    } );
+
+  vector < vector < unsigned int > > res;
+  for ( size_t c = 0; c < chunks; c++ ){
+    for ( size_t i = 0; i < parts[c].size(); i++ ){
+      res.push_back ( vector < unsigned int > () );
+      res.back().swap ( parts[c][i] );
+    }
+  }
+
+  return res;
+}
+
+vector < pair < unsigned int, double > > loadVertexValues ( const string& filename, ThreadPool& pool ){
+  MappedFile file ( filename );
+
+  size_t chunks = pool.size() * 4;
+  vector < size_t > bounds = lineChunks ( file, chunks );
+  vector < vector < pair < unsigned int, double > > > parts ( chunks );
+
+  pool.parallelFor ( 0, chunks, 1, [&] ( size_t lo, size_t hi ) {
+      for ( size_t c = lo; c < hi; c++ ){
+	const char* p = file.data() + bounds[c];
+	const char* end = file.data() + bounds[c+1];
+
+	while ( p < end ){
+	  double id, value;
+	  if ( readNumber ( p, end, id ) && readNumber ( p, end, value ) ){
+	    parts[c].push_back ( make_pair ( ( unsigned int ) id, value ) );
+	  }
+
+	  while ( ( p < end ) && ( *p != '\n' ) ) ++p;
+	  ++p;
+	}
+      }
+    } );
+
+  vector < pair < unsigned int, double > > res;
+  for ( size_t c = 0; c < chunks; c++ ){
+    res.insert ( res.end(), parts[c].begin(), parts[c].end() );
+  }
+
+  return res;
+}
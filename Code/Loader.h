@@ -0,0 +1,145 @@
+/**
+ *@file Loader.h
+ *
+ *   Reading existing networks into the model. Input files are
+ * memory-mapped and split into chunks at line boundaries, and the
+ * chunks are parsed in parallel on the network's thread pool.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_LOADER
+#define RPI_LOADER
+
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ *@struct BinaryEdgeRecord
+ *
+ *   Record of the binary edge list format: the file is nothing but
+ * a packed array of these, in native byte order.
+ */
+struct BinaryEdgeRecord {
+  unsigned int a;
+  unsigned int b;
+  double weight;
+};
+
+/**
+ *@class MappedFile
+ *
+ *   Read-only memory mapping of a whole file. Unmapped when the
+ * object goes away.
+ */
+class MappedFile {
+ public:
+  /**
+   *@fn MappedFile ( const string& filename )
+   *
+   *   Throws runtime_error if the file cannot be opened or mapped.
+   */
+  MappedFile ( const string& filename );
+  ~MappedFile ( );
+
+  const char* data ( ) const { return data_; }
+  size_t size ( ) const { return size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+
+  MappedFile ( const MappedFile& );
+  MappedFile& operator= ( const MappedFile& );
+};
+
+/**
+ *@class EdgeListReader
+ *
+ *   Reads a text edge list ( see loadEdgeList ) one edge at a time,
+ * straight from a mapping of the file, so only the current edge is
+ * held in memory.
+ */
+class EdgeListReader {
+ public:
+  /**
+   *@fn EdgeListReader ( const string& filename )
+   *
+   *   Throws runtime_error if the file cannot be opened or mapped.
+   */
+  EdgeListReader ( const string& filename ): file_ ( filename ), pos_ ( file_.data() ) {}
+
+  /**
+   *@fn bool next ( BinaryEdgeRecord& rec )
+   *
+   *@param rec Filled with the next edge, in file order
+   *@return False once the end of the file has been reached
+   */
+  bool next ( BinaryEdgeRecord& rec );
+
+ private:
+  MappedFile file_;
+  const char* pos_;                  //Start of the next line
+};
+
+/**
+ *@fn vector < BinaryEdgeRecord > loadEdgeList ( const string& filename, bool binary, ThreadPool& pool )
+ *
+ *   Reads an edge list. Text files hold one 'a|b|weight' line per
+ * edge ( the format printNetwork writes; spaces or tabs are also
+ * accepted as separators and a missing weight counts as 1 ). Binary
+ * files are arrays of BinaryEdgeRecord.
+ *
+ *@param filename Edge list to read
+ *@param binary True for the binary format
+ *@param pool Threads used for parsing
+ *@return All edges in file order
+ */
+vector < BinaryEdgeRecord > loadEdgeList ( const string& filename, bool binary, ThreadPool& pool );
+
+/**
+ *@fn vector < vector < unsigned int > > loadCommunities ( const string& filename, ThreadPool& pool )
+ *
+ *   Reads a community cover, one community per line. Lines are
+ * either plain lists of vertex ids or the 'id ( a b c )' lines
+ * printCommunities writes ( the id is dropped ).
+ *
+ *@param filename Community file to read
+ *@param pool Threads used for parsing
+ *@return Members of each community, in file order
+ */
+vector < vector < unsigned int > > loadCommunities ( const string& filename, ThreadPool& pool );
+
+/**
+ *@fn vector < pair < unsigned int, double > > loadVertexValues ( const string& filename, ThreadPool& pool )
+ *
+ *   Reads 'id value' lines ( any separator ), e.g. vertex energies.
+ *
+ *@param filename File to read
+ *@param pool Threads used for parsing
+ *@return ( id, value ) pairs in file order
+ */
+vector < pair < unsigned int, double > > loadVertexValues ( const string& filename, ThreadPool& pool );
+
+#endif
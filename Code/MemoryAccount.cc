@@ -0,0 +1,106 @@
+/**
+ *@file MemoryAccount.cc
+ *
+ *   Definitions for the shared side of memory accounting.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MemoryAccount.h"
+#include <atomic>
+
+/**
+ *@struct Counter
+ *
+ *   Shared count of one tag, on its own cache line.
+ */
+struct alignas ( 64 ) Counter {
+  atomic < long > current;
+  atomic < long > peak;
+};
+
+static Counter counters[MEM_TAGS];
+
+static const char* const NAMES[MEM_TAGS] = { "other", "vertices", "membership", "communities", "edges", "edge_set", "new_edge_set", "output" };
+
+static void raisePeak ( Counter& counter ){
+  long now = counter.current.load ( memory_order_relaxed );
+  long seen = counter.peak.load ( memory_order_relaxed );
+  while ( ( now > seen ) && !counter.peak.compare_exchange_weak ( seen, now, memory_order_relaxed ) );
+}
+
+#ifndef RPI_NO_MEMTRACK
+thread_local MemoryAccount::Pending MemoryAccount::pending_;
+
+MemoryAccount::Pending::Pending ( ){
+  for ( unsigned int t = 0; t < MEM_TAGS; t++ ) balance[t] = 0;
+}
+
+MemoryAccount::Pending::~Pending ( ){
+  for ( unsigned int t = 0; t < MEM_TAGS; t++ ){
+    if ( balance[t] != 0 ) flush ( ( MemTag ) t );
+  }
+}
+
+void MemoryAccount::flush ( MemTag tag ){
+  long& balance = pending_.balance[tag];
+  counters[tag].current.fetch_add ( balance, memory_order_relaxed );
+  balance = 0;
+  raisePeak ( counters[tag] );
+}
+#endif
+
+long MemoryAccount::current ( MemTag tag ){
+  return counters[tag].current.load ( memory_order_relaxed );
+}
+
+long MemoryAccount::peak ( MemTag tag ){
+  return counters[tag].peak.load ( memory_order_relaxed );
+}
+
+void MemoryAccount::sync ( ){
+#ifndef RPI_NO_MEMTRACK
+  for ( unsigned int t = 0; t < MEM_TAGS; t++ ){
+    if ( pending_.balance[t] != 0 ) flush ( ( MemTag ) t );
+  }
+#endif
+}
+
+void MemoryAccount::resetPeaks ( ){
+  sync();
+  for ( unsigned int t = 0; t < MEM_TAGS; t++ ){
+    counters[t].peak.store ( counters[t].current.load ( memory_order_relaxed ), memory_order_relaxed );
+  }
+}
+
+void MemoryAccount::exchange ( MemTag a, MemTag b ){
+  sync();
+  long moved = counters[a].current.exchange ( counters[b].current.load ( memory_order_relaxed ), memory_order_relaxed );
+  counters[b].current.store ( moved, memory_order_relaxed );
+
+  //Each tag now holds what the other did
+  raisePeak ( counters[a] );
+  raisePeak ( counters[b] );
+}
+
+const char* MemoryAccount::name ( MemTag tag ){
+  return NAMES[tag];
+}
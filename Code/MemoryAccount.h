@@ -0,0 +1,212 @@
+/**
+ *@file MemoryAccount.h
+ *
+ *   Accounting of the model's memory by subsystem. Containers of the
+ * network allocate through TrackedAllocator, which charges every
+ * allocation to the tag the container was built with; buffers that
+ * are not containers of the model are charged by hand. Current and
+ * peak bytes of each tag are reported once per window
+ * ( Network::reportMemory ).
+ *
+ *   Building with -DRPI_NO_MEMTRACK removes the accounting: the
+ * allocator then only draws from its base ( the NodePool or a
+ * NodeArena ) and charges compile to nothing.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_MEMACCOUNT
+#define RPI_MEMACCOUNT
+
+#include "NodePool.h"
+
+using namespace std;
+
+/**
+ *@enum MemTag
+ *
+ *   Subsystems memory is charged to.
+ */
+enum MemTag {
+  MEM_OTHER,           //Containers built without a tag
+  MEM_VERTICES,        //Vertex objects and the vertex index
+  MEM_MEMBERSHIP,      //Network::membership_
+  MEM_COMMUNITIES,     //Member sets of communities
+  MEM_EDGES,           //Edge objects and their member sets
+  MEM_EDGE_SET,        //Nodes of Network::E_
+  MEM_NEW_EDGE_SET,    //Nodes of the edge set being built for a window
+  MEM_OUTPUT,          //Formatting and event buffers
+  MEM_TAGS
+};
+
+/**
+ *@class MemoryAccount
+ *
+ *   Charges are first summed per thread and reach the shared counters
+ * once a thread's balance for a tag moves by FLUSH bytes, so counts
+ * read while other threads are allocating may be off by up to FLUSH
+ * bytes per thread and tag. Peaks are taken on the shared counters.
+ */
+class MemoryAccount {
+ public:
+  static const long FLUSH = 64 * 1024;
+
+#ifdef RPI_NO_MEMTRACK
+  static void add ( MemTag, size_t ) { }
+  static void sub ( MemTag, size_t ) { }
+  static bool enabled ( ) { return false; }
+#else
+  static void add ( MemTag tag, size_t bytes ){
+    long& balance = pending_.balance[tag];
+    balance += bytes;
+    if ( balance > FLUSH ) flush ( tag );
+  }
+
+  static void sub ( MemTag tag, size_t bytes ){
+    long& balance = pending_.balance[tag];
+    balance -= bytes;
+    if ( balance < -FLUSH ) flush ( tag );
+  }
+
+  static bool enabled ( ) { return true; }
+#endif
+
+  /**
+   *@fn long current ( MemTag tag )
+   *@fn long peak ( MemTag tag )
+   *
+   *@return Bytes charged to tag now, and at most since the last
+   *         resetPeaks
+   */
+  static long current ( MemTag tag );
+  static long peak ( MemTag tag );
+
+  /**
+   *@fn void sync ( )
+   *
+   *   Adds the calling thread's pending charges to the shared counts.
+   */
+  static void sync ( );
+
+  /**
+   *@fn void resetPeaks ( )
+   *
+   *   Starts new peaks from the current counts ( after the calling
+   * thread's charges are flushed ).
+   */
+  static void resetPeaks ( );
+
+  /**
+   *@fn void exchange ( MemTag a, MemTag b )
+   *
+   *   Swaps the current counts of two tags, for when two containers
+   * with different tags swap their contents.
+   */
+  static void exchange ( MemTag a, MemTag b );
+
+  static const char* name ( MemTag tag );
+
+ private:
+  /**
+   *@struct Pending
+   *
+   *   One thread's charges not yet added to the shared counters.
+   * Flushed when the thread exits.
+   */
+  struct Pending {
+    long balance[MEM_TAGS];
+
+    Pending ( );
+    ~Pending ( );
+  };
+
+  static thread_local Pending pending_;
+
+  static void flush ( MemTag tag );
+};
+
+/**
+ *@class TrackedAllocator
+ *
+ *   Allocator that charges what it hands out to a tag, drawing the
+ * memory from Base ( the NodePool by default, or a NodeArena ). The
+ * tag is copied into rebound allocators, so the nodes of a container
+ * are charged to the tag the container was built with. Allocators
+ * compare equal when their bases do.
+ *
+ *   Swapping two allocators, as containers whose bases propagate do
+ * when swapped, only swaps what they draw from: each container keeps
+ * charging its own tag ( see MemoryAccount::exchange ).
+ */
+template < class T, template < class > class Base = PoolAllocator >
+class TrackedAllocator: public Base < T > {
+ public:
+  typedef T value_type;
+
+  template < class U >
+  struct rebind {
+    typedef TrackedAllocator < U, Base > other;
+  };
+
+#ifdef RPI_NO_MEMTRACK
+  TrackedAllocator ( MemTag = MEM_OTHER ) { }
+  template < class U >
+  TrackedAllocator ( const TrackedAllocator < U, Base >& other ): Base < T > ( other ) { }
+
+  MemTag tag ( ) const { return MEM_OTHER; }
+#else
+  TrackedAllocator ( MemTag tag = MEM_OTHER ): tag_ ( tag ) { }
+  template < class U >
+  TrackedAllocator ( const TrackedAllocator < U, Base >& other ): Base < T > ( other ), tag_ ( other.tag() ) { }
+
+  T* allocate ( size_t n ){
+    MemoryAccount::add ( tag_, n * sizeof ( T ) );
+    return Base < T >::allocate ( n );
+  }
+
+  void deallocate ( T* p, size_t n ){
+    MemoryAccount::sub ( tag_, n * sizeof ( T ) );
+    Base < T >::deallocate ( p, n );
+  }
+
+  MemTag tag ( ) const { return tag_; }
+
+ private:
+  MemTag tag_;
+#endif
+};
+
+template < class T, class U, template < class > class Base >
+bool operator== ( const TrackedAllocator < T, Base >& a, const TrackedAllocator < U, Base >& b ) {
+  return static_cast < const Base < T >& > ( a ) == static_cast < const Base < U >& > ( b );
+}
+
+template < class T, class U, template < class > class Base >
+bool operator!= ( const TrackedAllocator < T, Base >& a, const TrackedAllocator < U, Base >& b ) { return !( a == b ); }
+
+template < class T, template < class > class Base >
+void swap ( TrackedAllocator < T, Base >& a, TrackedAllocator < T, Base >& b ){
+  Base < T > base ( a );
+  static_cast < Base < T >& > ( a ) = b;
+  static_cast < Base < T >& > ( b ) = base;
+}
+
+#endif
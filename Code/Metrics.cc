@@ -0,0 +1,142 @@
+/**
+ *@file Metrics.cc
+ *
+ *   Definitions of the member functions for the Metrics class.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Metrics.h"
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+
+static const char* PHASE_NAMES[] = { "vertices", "communities", "edges", "output" };
+
+static const char* COUNTER_NAMES[][2] = {
+  { "rpi_windows_completed_total", "Windows fully generated" },
+  { "rpi_edges_generated_total", "Edges created for the first time" },
+  { "rpi_edges_reused_total", "Edges carried over from the previous window" },
+  { "rpi_interactions_total", "Interactions simulated ( sum of edge weights )" },
+  { "rpi_vertices_retired_total", "Vertices retired" },
+  { "rpi_bytes_written_total", "Bytes written to output files" }
+};
+
+static const char* GAUGE_NAMES[][2] = {
+  { "rpi_vertices", "Vertices in the current window" },
+  { "rpi_communities_live", "Non-empty communities" },
+  { "rpi_communities_empty", "Empty communities waiting for compaction" },
+  { "rpi_edges", "Edges with a positive weight in the current window" }
+};
+
+Metrics::Metrics ( const string& filename, double interval ): filename_(filename), interval_(interval), stop_(false) {
+  for ( int i = 0; i < NUM_COUNTERS; i++ ) counters_[i] = 0;
+  for ( int i = 0; i < NUM_GAUGES; i++ ) gauges_[i] = 0;
+  for ( int i = 0; i < NUM_PHASES; i++ ){
+    phase_nanos_[i] = 0;
+    phase_items_[i] = 0;
+    phase_rate_[i] = 0;
+  }
+
+  if ( interval_ > 0 ){
+    writer_ = thread ( &Metrics::writerLoop, this );
+  }
+}
+
+Metrics::~Metrics ( ){
+  {
+    lock_guard < mutex > guard ( stop_lock_ );
+    stop_ = true;
+  }
+  stop_wake_.notify_all();
+  if ( writer_.joinable() ) writer_.join();
+
+  write();
+}
+
+void Metrics::addPhase ( Phase p, double seconds, uint64_t items ){
+  phase_nanos_[p].fetch_add ( ( uint64_t ) ( seconds * 1e9 ), memory_order_relaxed );
+  phase_items_[p].fetch_add ( items, memory_order_relaxed );
+  phase_rate_[p].store ( ( seconds > 0 ) ? items / seconds : 0, memory_order_relaxed );
+}
+
+const char* Metrics::phaseName ( Phase p ){
+  return PHASE_NAMES[p];
+}
+
+void Metrics::write ( ){
+  lock_guard < mutex > guard ( write_lock_ );
+  string tmp = filename_ + ".tmp";
+  ofstream fout ( tmp.c_str() );
+
+  for ( int i = 0; i < NUM_COUNTERS; i++ ){
+    fout << "# HELP " << COUNTER_NAMES[i][0] << " " << COUNTER_NAMES[i][1] << "\n";
+    fout << "# TYPE " << COUNTER_NAMES[i][0] << " counter\n";
+    fout << COUNTER_NAMES[i][0] << " " << counters_[i].load ( memory_order_relaxed ) << "\n";
+  }
+  for ( int i = 0; i < NUM_GAUGES; i++ ){
+    fout << "# HELP " << GAUGE_NAMES[i][0] << " " << GAUGE_NAMES[i][1] << "\n";
+    fout << "# TYPE " << GAUGE_NAMES[i][0] << " gauge\n";
+    fout << GAUGE_NAMES[i][0] << " " << gauges_[i].load ( memory_order_relaxed ) << "\n";
+  }
+
+  //Resident set size is the second field of statm, in pages
+  unsigned long pages = 0, resident = 0;
+  FILE* statm = fopen ( "/proc/self/statm", "r" );
+  if ( statm ){
+    if ( fscanf ( statm, "%lu %lu", &pages, &resident ) != 2 ) resident = 0;
+    fclose ( statm );
+  }
+  fout << "# HELP rpi_resident_memory_bytes Resident set size of the process\n";
+  fout << "# TYPE rpi_resident_memory_bytes gauge\n";
+  fout << "rpi_resident_memory_bytes " << resident * ( unsigned long ) sysconf ( _SC_PAGESIZE ) << "\n";
+
+  fout << "# HELP rpi_phase_seconds_total Time spent in each phase\n";
+  fout << "# TYPE rpi_phase_seconds_total counter\n";
+  for ( int i = 0; i < NUM_PHASES; i++ ){
+    fout << "rpi_phase_seconds_total{phase=\"" << PHASE_NAMES[i] << "\"} " << phase_nanos_[i].load ( memory_order_relaxed ) / 1e9 << "\n";
+  }
+  fout << "# HELP rpi_phase_items_total Items handled by each phase ( vertices, communities, edges, bytes )\n";
+  fout << "# TYPE rpi_phase_items_total counter\n";
+  for ( int i = 0; i < NUM_PHASES; i++ ){
+    fout << "rpi_phase_items_total{phase=\"" << PHASE_NAMES[i] << "\"} " << phase_items_[i].load ( memory_order_relaxed ) << "\n";
+  }
+  fout << "# HELP rpi_phase_rate Items per second in the last run of each phase\n";
+  fout << "# TYPE rpi_phase_rate gauge\n";
+  for ( int i = 0; i < NUM_PHASES; i++ ){
+    fout << "rpi_phase_rate{phase=\"" << PHASE_NAMES[i] << "\"} " << phase_rate_[i].load ( memory_order_relaxed ) << "\n";
+  }
+
+  fout.close();
+  rename ( tmp.c_str(), filename_.c_str() );
+}
+
+void Metrics::writerLoop ( ){
+  unique_lock < mutex > guard ( stop_lock_ );
+  while ( !stop_ ){
+    stop_wake_.wait_for ( guard, chrono::duration < double > ( interval_ ), [this] ( ) { return stop_; } );
+    if ( stop_ ) return;
+
+    guard.unlock();
+    write();
+    guard.lock();
+  }
+}
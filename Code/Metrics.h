@@ -0,0 +1,149 @@
+/**
+ *@file Metrics.h
+ *
+ *   Live progress metrics of a generation run, exported as a text
+ * file in the Prometheus exposition format.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_METRICS
+#define RPI_METRICS
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ *@class Metrics
+ *
+ *   Counters and gauges describing a run. A background thread
+ * rewrites the metrics file every few seconds ( through a temporary
+ * file and a rename, so scrapers never see half a file ), and the
+ * file is also rewritten whenever a window completes.
+ *
+ *   Values are relaxed atomics. Phases accumulate their counts
+ * locally and add them once per phase, so the per-edge and
+ * per-interaction loops never touch shared state.
+ */
+class Metrics {
+ public:
+  enum Phase {
+    PHASE_VERTICES = 0,      //Retirement and new vertices
+    PHASE_COMMUNITIES,       //Community events, compaction and fills
+    PHASE_EDGES,             //Candidate pairs and weights
+    PHASE_OUTPUT,            //Network, community and event files
+    NUM_PHASES
+  };
+
+  enum Counter {
+    WINDOWS = 0,             //Windows completed
+    EDGES_GENERATED,         //Edges created for the first time
+    EDGES_REUSED,            //Edges carried over from the last window
+    INTERACTIONS,            //Interactions simulated ( sum of weights )
+    VERTICES_RETIRED,        //Vertices retired
+    BYTES_WRITTEN,           //Bytes of output files
+    NUM_COUNTERS
+  };
+
+  enum Gauge {
+    VERTICES = 0,            //Vertices in the current window
+    COMMUNITIES_LIVE,        //Non-empty communities
+    COMMUNITIES_EMPTY,       //Empty communities not compacted yet
+    EDGES,                   //Edges with a positive weight
+    NUM_GAUGES
+  };
+
+  /**
+   *@fn Metrics ( const string& filename, double interval )
+   *
+   *@param filename File rewritten with the metrics
+   *@param interval Seconds between rewrites by the background thread
+   *                 ( 0 = only when a window completes )
+   */
+  Metrics ( const string& filename, double interval );
+  ~Metrics ( );
+
+  void add ( Counter c, uint64_t n ) { counters_[c].fetch_add ( n, memory_order_relaxed ); }
+  void set ( Gauge g, uint64_t value ) { gauges_[g].store ( value, memory_order_relaxed ); }
+
+  /**
+   *@fn void addPhase ( Phase p, double seconds, uint64_t items )
+   *
+   *   Records one run of a phase. The rate of the last run ( items
+   * per second ) is exported next to the cumulative time.
+   */
+  void addPhase ( Phase p, double seconds, uint64_t items );
+
+  static const char* phaseName ( Phase p );
+
+  /**
+   *@fn void write ( )
+   *
+   *   Rewrites the metrics file now.
+   */
+  void write ( );
+
+  /**
+   *@class Metrics::Timer
+   *
+   *   Times a phase from construction to destruction. Safe to use
+   * with a NULL Metrics, in which case it does nothing.
+   */
+  class Timer {
+  public:
+  Timer ( Metrics* m, Phase p ): m_(m), p_(p), items_(0), start_ ( chrono::steady_clock::now() ) {}
+    ~Timer ( ){
+      if ( m_ ) m_->addPhase ( p_, chrono::duration < double > ( chrono::steady_clock::now() - start_ ).count(), items_ );
+    }
+    void items ( uint64_t n ) { items_ += n; }
+  private:
+    Metrics* m_;
+    Phase p_;
+    uint64_t items_;
+    chrono::steady_clock::time_point start_;
+  };
+
+ private:
+  string filename_;
+  double interval_;
+  atomic < uint64_t > counters_[NUM_COUNTERS];
+  atomic < uint64_t > gauges_[NUM_GAUGES];
+  atomic < uint64_t > phase_nanos_[NUM_PHASES];
+  atomic < uint64_t > phase_items_[NUM_PHASES];
+  atomic < double > phase_rate_[NUM_PHASES];
+
+  mutex write_lock_;              //One writer of the file at a time
+  mutex stop_lock_;
+  condition_variable stop_wake_;
+  bool stop_;
+  thread writer_;
+
+  void writerLoop ( );
+};
+
+#endif
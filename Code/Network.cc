@@ -25,52 +25,162 @@ This file is part of RPI-evo-model.
  */
 
 #include "Network.h"
+#include <atomic>
+#include <unistd.h>
+
+string Network::spillPrefix ( const string& dir ){
+  static atomic < unsigned int > built ( 0 );
+  return dir + "/rpi-evo-" + to_str < int > ( getpid() ) + "-" + to_str < unsigned int > ( built++ );
+}
 
 void Network::RandomNetwork ( unique_ptr < Parameters >& P ) { 
   
-  //Goes through and initializes each vertex individually         
-  unsigned int num_vert = P->get < unsigned int > ( "V", 1000 );
-  for ( unsigned int i = 0; i < num_vert; i++ ){
-    addRandomVertex();
+  //Initializes all vertices in one batch
+  {
+    Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_VERTICES );
+    PerfCounters::Scope counted ( perf_.get(), perf_totals_[Metrics::PHASE_VERTICES] );
+    addRandomVertices ( P->get < unsigned int > ( "V", 1000 ) );
+    timer.items ( V_.size() );
   }
   
-  //Create community structure with randomly sampled vertices
-  if ( P->hasFlag ( "cnum" ) ) {
-    //Constructs a certain number of communities
-    int target = P->get < int > ( "cnum" );
-    for ( int i = 0; i < target; i++ ){
-      addCommunity ( RandomCommunity ( cpl_->Sample() ) );
-    }
-  } else {
-    //Constructs communities until vertices have a target average
-    //    membership
-    double target_membership = P->get < double > ( "vmem", 1.2 );
-    unsigned int total_size = 0;
+  {
+    Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_COMMUNITIES );
+    PerfCounters::Scope counted ( perf_.get(), perf_totals_[Metrics::PHASE_COMMUNITIES] );
+
+    //Create community structure with randomly sampled vertices
+    if ( P->hasFlag ( "cnum" ) ) {
+      //Constructs a certain number of communities
+      int target = P->get < int > ( "cnum" );
+      for ( int i = 0; i < target; i++ ){
+	addCommunity ( RandomCommunity ( csizes_() ) );
+      }
+    } else {
+      //Constructs communities until vertices have a target average
+      //    membership
+      double target_membership = P->get < double > ( "vmem", 1.2 );
+      unsigned int total_size = 0;
     
-    while ( total_size < ( target_membership * NumVerts() ) ){
-      unsigned int next_size = cpl_->Sample();
-      total_size += next_size;
+      while ( total_size < ( target_membership * NumVerts() ) ){
+	unsigned int next_size = csizes_();
+	total_size += next_size;
 
-      addCommunity ( RandomCommunity ( next_size ) );
+	addCommunity ( RandomCommunity ( next_size ) );
+      }
     }
-  }
 
-  //Make sure each vertex has at least one community membership
-  fillCommunities();
+    //Make sure each vertex has at least one community membership
+    fillCommunities();
+    timer.items ( C_.size() );
+  }
   
   //Construct edge structure
   populateEdges(P);
+  if ( hyper_k_ > 0 ) populateHyperedges ( P );
+}
+
+void Network::loadNetwork ( unique_ptr < Parameters >& P ){
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_EDGES );
+  PerfCounters::Scope counted ( perf_.get(), perf_totals_[Metrics::PHASE_EDGES] );
+  vector < BinaryEdgeRecord > edges = loadEdgeList ( P->get < string > ( "in" ), P->hasFlag ( "inbin" ), *pool_ );
+  vector < vector < unsigned int > > coms;
+  if ( P->hasFlag ( "incom" ) ){
+    coms = loadCommunities ( P->get < string > ( "incom" ), *pool_ );
+  }
+
+  //Ids are dense, up to the largest one mentioned anywhere
+  unsigned int id_range = 0;
+  for ( size_t i = 0; i < edges.size(); i++ ){
+    id_range = max ( id_range, max ( edges[i].a, edges[i].b ) + 1 );
+  }
+  for ( size_t i = 0; i < coms.size(); i++ ){
+    for ( size_t j = 0; j < coms[i].size(); j++ ){
+      id_range = max ( id_range, coms[i][j] + 1 );
+    }
+  }
+
+  //Puts each pair in ( low, high ) order and drops self loops and
+  //   repeated pairs ( the first weight is kept )
+  size_t kept = 0;
+  for ( size_t i = 0; i < edges.size(); i++ ){
+    if ( edges[i].a == edges[i].b ) continue;
+    if ( edges[i].a > edges[i].b ) swap ( edges[i].a, edges[i].b );
+    edges[kept++] = edges[i];
+  }
+  edges.resize ( kept );
+  stable_sort ( edges.begin(), edges.end(), [] ( const BinaryEdgeRecord& x, const BinaryEdgeRecord& y ) { return ( x.a < y.a ) || ( ( x.a == y.a ) && ( x.b < y.b ) ); } );
+  edges.erase ( unique ( edges.begin(), edges.end(), [] ( const BinaryEdgeRecord& x, const BinaryEdgeRecord& y ) { return ( x.a == y.a ) && ( x.b == y.b ); } ), edges.end() );
+
+  //Energies are given, or follow the observed degrees
+  double vmin = P->get < double > ( "vmin", 0.4 ), vmax = P->get < double > ( "vmax", 1 );
+  vector < double > energies ( id_range, vmin );
+  if ( P->hasFlag ( "inenergy" ) ){
+    vector < pair < unsigned int, double > > values = loadVertexValues ( P->get < string > ( "inenergy" ), *pool_ );
+    for ( size_t i = 0; i < values.size(); i++ ){
+      if ( values[i].first < id_range ) energies[values[i].first] = values[i].second;
+    }
+  } else {
+    vector < unsigned int > degree ( id_range, 0 );
+    unsigned int max_degree = 0;
+    for ( size_t i = 0; i < edges.size(); i++ ){
+      max_degree = max ( max_degree, ++degree[edges[i].a] );
+      max_degree = max ( max_degree, ++degree[edges[i].b] );
+    }
+    for ( unsigned int v = 0; v < id_range; v++ ){
+      if ( max_degree > 0 ) energies[v] = max ( vmin, vmax * degree[v] / max_degree );
+    }
+  }
+  if ( id_range > 0 ) addVertices ( &energies[0], id_range );
+
+  for ( size_t i = 0; i < coms.size(); i++ ){
+    shared_ptr < Community > com ( new Community() );
+    for ( size_t j = 0; j < coms[i].size(); j++ ){
+      com->addMember ( V_[coms[i][j]] );
+    }
+    addCommunity ( com );
+  }
+  fillCommunities();
+
+  //Edges are built on the pool, then inserted in order so each
+  //   insert lands at the end of E_
+  vector < shared_ptr < Edge > > built ( edges.size() );
+  pool_->parallelFor ( 0, edges.size(), 4096, [&] ( size_t lo, size_t hi ) {
+      for ( size_t i = lo; i < hi; i++ ){
+	built[i] = allocate_shared < Edge > ( TrackedAllocator < Edge > ( MEM_EDGES ) );
+	built[i]->addMember ( V_[edges[i].a] );
+	built[i]->addMember ( V_[edges[i].b] );
+	built[i]->setWeight ( edges[i].weight );
+      }
+    } );
+
+  E_.clear();
+  for ( size_t i = 0; i < built.size(); i++ ){
+    E_.insert ( E_.end(), built[i] );
+    if ( edges[i].weight > 0 ){
+      V_[edges[i].a]->incrementEdgeCount();
+      V_[edges[i].b]->incrementEdgeCount();
+    }
+  }
+  recordEdges ( timer, 0 );
+  if ( streaming_ ) streamEdgeSet();
+  if ( hyper_k_ > 0 ) populateHyperedges ( P );
+
+  //A loaded window has no simulated interactions, but still gets
+  //   its ( empty ) event file so numbering matches the windows
+  if ( events_ ){
+    events_->open();
+    addBytesWritten ( events_->close() );
+  }
 }
 
 shared_ptr < Community > Network::RandomCommunity ( unsigned int size ) {
   // Empty result community seed
   shared_ptr < Community > res ( new Community() );
 
-  // Continually adds members to community until target size is reached
-  for ( int i = 0; i < size; i++ ){
-    if ( !res->addMember ( getRandomVertex () ) ){
-      --i; 
-    }
+  // Draws all members at once, without repeats
+  vector < size_t > slots;
+  sampleNewMembers ( *res, size, [] ( ) { return random_double(); }, slots );
+  for ( size_t i = 0; i < slots.size(); i++ ){
+    res->addMember ( V_[slots[i]] );
   }
   
   return res;
@@ -78,32 +188,54 @@ shared_ptr < Community > Network::RandomCommunity ( unsigned int size ) {
 
 
 void Network::populateEdges ( unique_ptr < Parameters >& P ){
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_EDGES );
+  PerfCounters::Scope counted ( perf_.get(), perf_totals_[Metrics::PHASE_EDGES] );
+  const LagSamplerCache& cache = lagCache ( P );
+
+  if ( streaming_ ){
+    populateEdgesStreaming ( P, timer );
+    return;
+  }
+
+  //Checks if the edge structure is expected to fit in the memory
+  //   budget. Every pair in a community is a candidate, and external
+  //   edges add ( 1 - mp ) / mp of that on top.
+  if ( mem_budget_ > 0 ){
+    double candidates = 0;
+    for ( unsigned int i = 0; i < C_.size(); i++ ){
+      double csize = C_[i]->size();
+      candidates += csize * ( csize - 1 ) / 2 * ( ( ( skip_size_ > 0 ) && ( csize >= skip_size_ ) ) ? skip_density_ : 1.0 );
+    }
+    candidates /= P->get < double > ( "mp", 0.85 );
+
+    //Once spilled, the carried over state only exists on disk
+    if ( spilled_ || ( ( candidates * EDGE_BYTES ) > mem_budget_ ) ){
+      populateEdgesExternal ( P, timer );
+      return;
+    }
+  }
+
   //Generates internal edges, copying old edge if exists
-  eset new_edge_set;
+  eset new_edge_set ( ( cmp_pedge() ), eset::allocator_type ( MEM_NEW_EDGE_SET ) );
   eset::iterator it_e; 
+  unsigned long reused = 0;
   
   //Goes through each pair of vertices that shares a community
   //  multiple edges are taken care of by the automatic 
   //  uniqueness of stl set containers and custom comparators
   for ( int i = 0; i < C_.size(); i++ ){
-    const vset verts = C_[i]->getMembers();
-    
-    vset::const_iterator it_a, it_b;
-    for ( it_a = verts.begin(); it_a != verts.end(); it_a++ ){
-      it_b = it_a;
-      for (++it_b; it_b != verts.end(); it_b++ ){
-	shared_ptr < Edge > new_edge ( new Edge () );
-	new_edge->addMember ( *it_a );
-	new_edge->addMember ( *it_b );
-	new_edge->generateWeight( P ); //Initializes the edge with
+    visitCommunityPairs ( i, [&] ( const shared_ptr < Vertex >& A, const shared_ptr < Vertex >& B ) {
+	shared_ptr < Edge > new_edge = allocate_shared < Edge > ( TrackedAllocator < Edge > ( MEM_EDGES ) );
+	new_edge->addMember ( A );
+	new_edge->addMember ( B );
+	new_edge->generateWeight( cache ); //Initializes the edge with
 	                               //   a non-zero wait time
 	if ( ( it_e = E_.find ( new_edge ) ) != E_.end() ){
-	  new_edge_set.insert ( *it_e );
+	  if ( new_edge_set.insert ( *it_e ).second ) ++reused;
 	} else {
 	  new_edge_set.insert ( new_edge );
 	}
-      }
-    }
+      } );
   }
  
   //Generates external edges, copying old if exists
@@ -111,45 +243,643 @@ void Network::populateEdges ( unique_ptr < Parameters >& P ){
   int edges_to_generate = ( (1.0 - mixing_parameter) / mixing_parameter ) * new_edge_set.size();
 
   for ( int i = 0; i < edges_to_generate; i++ ){
-    shared_ptr < Edge > new_edge ( new Edge() );
+    shared_ptr < Edge > new_edge = allocate_shared < Edge > ( TrackedAllocator < Edge > ( MEM_EDGES ) );
     new_edge->addMember ( getRandomVertex() );
     new_edge->addMember ( getRandomVertex() );
-    new_edge->generateWeight ( P );
+    new_edge->generateWeight ( cache );
     
     //Makes sure the edge is external
-    if ( ( it_e = new_edge_set.find ( new_edge ) ) != E_.end () ){
+    if ( ( it_e = new_edge_set.find ( new_edge ) ) != new_edge_set.end () ){
       continue;
     }
  
     //Adds old edge if it was already active ( low probaility, but still...)
     if ( ( it_e = E_.find ( new_edge ) ) != E_.end() ){
-      new_edge_set.insert ( *it_e );
+      if ( new_edge_set.insert ( *it_e ).second ) ++reused;
     } else {
       new_edge_set.insert ( new_edge );
     }
   }
   
-  //Copies new edge set to network
-  E_ = new_edge_set;
+  //Moves new edge set, with its arena, into the network. The old
+  //   window's arena is freed in one step when new_edge_set leaves
+  //   scope, after the set has let go of its edges
+  E_.swap ( new_edge_set );
+  MemoryAccount::exchange ( MEM_EDGE_SET, MEM_NEW_EDGE_SET );
   
   //Resets edge counts for vertices
-  vset::iterator it_v;
+  vector < shared_ptr < Vertex > >::iterator it_v;
   for ( it_v = V_.begin(); it_v != V_.end(); it_v++ ){
     (*it_v)->resetEdgeCount();
   }
   
   //Generates new weights for all edges
+  if ( events_ ) events_->open();
+  if ( pool_->serial() ){
+    for ( it_e = E_.begin(); it_e != E_.end(); it_e++ ){
+      (*it_e)->generateWeight ( cache, true, events_.get() );
+    }
+    if ( events_ ) addBytesWritten ( events_->close() );
+    recordEdges ( timer, reused );
+    return;
+  }
+
+  //In parallel, each fixed block of edges has its own stream so the
+  //   weights do not depend on how blocks were spread over threads.
+  //   Edge counts are added up afterwards.
+  vector < Edge* > edges;
+  edges.reserve ( E_.size() );
   for ( it_e = E_.begin(); it_e != E_.end(); it_e++ ){
-    (*it_e)->generateWeight ( P );
+    edges.push_back ( it_e->get() );
   }
+
+  const size_t block = 1024;
+  pool_->parallelFor ( 0, ( edges.size() + block - 1 ) / block, 1, [&] ( size_t lo, size_t hi ) {
+      for ( size_t b = lo; b < hi; b++ ){
+	rstream rng ( streamSeed ( seed_, STREAM_WEIGHT, current_window_, b ) );
+	size_t end = min ( edges.size(), ( b + 1 ) * block );
+	for ( size_t e = b * block; e < end; e++ ){
+	  edges[e]->generateWeight ( cache, rng, false, events_.get() );
+	}
+      }
+    } );
+  if ( events_ ) addBytesWritten ( events_->close() );
+
+  for ( size_t e = 0; e < edges.size(); e++ ){
+    if ( edges[e]->getWeight() > 0 ){
+      const vset& members = edges[e]->getMembers();
+      for ( vset::const_iterator it_m = members.begin(); it_m != members.end(); it_m++ ){
+	(*it_m)->incrementEdgeCount();
+      }
+    }
+  }
+  recordEdges ( timer, reused );
 }
 
-void Network::addRandomVertex ( ){
-  //Generates new energy
-  double next_energy = vpl_->Sample();
-  total_energy_ += next_energy;
-  //Inserts vertex into network
-  V_.insert ( shared_ptr < Vertex > ( new Vertex ( next_id_++, next_energy ) ) );
+void Network::populateEdgesExternal ( unique_ptr < Parameters >& P, Metrics::Timer& timer ){
+  const LagSamplerCache& cache = lagCache ( P );
+
+  //Moves carried over edges out of memory the first time through
+  if ( !spilled_ ){
+    spillEdgeSet();
+  }
+
+  //Half of the budget holds unsorted pairs, a quarter is split
+  //   between the read buffers of the runs being merged.
+  size_t run_capacity = max < size_t > ( mem_budget_ / ( 2 * sizeof ( PairRecord ) ), 1024 );
+  size_t merge_buffer = max < size_t > ( mem_budget_ / 4, 1 << 20 );
+  string prefix = spill_prefix_ + "-spill" + to_str < int > ( current_window_ );
+  PairRecord rec;
+
+  //Writes out each pair of vertices that shares a community. 
+  //   Duplicates are removed when runs are written and merged.
+  RunSorter < PairRecord > internal ( prefix + "-int", run_capacity );
+  for ( unsigned int i = 0; i < C_.size(); i++ ){
+    visitCommunityPairs ( i, [&] ( const shared_ptr < Vertex >& A, const shared_ptr < Vertex >& B ) {
+	rec.a = A->getID();
+	rec.b = B->getID();
+	internal.push ( rec );
+      } );
+  }
+  vector < string > runs = internal.finish();
+
+  //Counts distinct internal edges to size the external edge set
+  unsigned long internal_edges = 0;
+  {
+    RunMerger < PairRecord > counter ( runs, merge_buffer );
+    while ( counter.next ( rec ) ){
+      ++internal_edges;
+    }
+  }
+
+  //Generates external edges into their own runs. Pairs that are 
+  //   already internal disappear in the final merge.
+  double mixing_parameter = P->get < double > ( "mp", 0.85 );
+  unsigned long edges_to_generate = ( (1.0 - mixing_parameter) / mixing_parameter ) * internal_edges;
+  
+  RunSorter < PairRecord > external ( prefix + "-ext", run_capacity );
+  for ( unsigned long i = 0; i < edges_to_generate; i++ ){
+    unsigned int a = getRandomVertex()->getID();
+    unsigned int b = getRandomVertex()->getID();
+    if ( a == b ) continue;
+
+    rec.a = min ( a, b );
+    rec.b = max ( a, b );
+    external.push ( rec );
+  }
+  const vector < string >& external_runs = external.finish();
+  runs.insert ( runs.end(), external_runs.begin(), external_runs.end() );
+  
+  //Resets edge counts for vertices
+  vector < shared_ptr < Vertex > >::iterator it_v;
+  for ( it_v = V_.begin(); it_v != V_.end(); it_v++ ){
+    (*it_v)->resetEdgeCount();
+  }
+
+  //Merge-joins the sorted candidate pairs against the sorted table
+  //   of carried over edges, writing the next table as it goes.
+  string next_state = stateFile() + ".next";
+  if ( events_ ) events_->open();
+  {
+    RunMerger < PairRecord > pairs ( runs, merge_buffer );
+    RunReader < EdgeStateRecord > old_state ( stateFile() );
+    RunWriter < EdgeStateRecord > new_state ( next_state );
+    
+    EdgeStateRecord old, out;
+    bool has_old = old_state.next ( old );
+    unsigned long generated = 0, reused = 0, active = 0;
+    double interactions = 0;
+    
+    while ( pairs.next ( rec ) ){
+      //Old edges that were not generated again are dropped
+      while ( has_old && ( ( old.a < rec.a ) || ( ( old.a == rec.a ) && ( old.b < rec.b ) ) ) ){
+	has_old = old_state.next ( old );
+      }
+
+      Edge edge;
+      edge.addMember ( getVertex ( rec.a ) );
+      edge.addMember ( getVertex ( rec.b ) );
+
+      if ( has_old && ( old.a == rec.a ) && ( old.b == rec.b ) ){
+	edge.setWaitTime ( old.wait_time );
+	++reused;
+      } else {
+	edge.generateWeight ( cache, false ); //Initializes the edge with
+	                                  //   a non-zero wait time
+	++generated;
+      }
+      edge.generateWeight ( cache, true, events_.get() );
+
+      out.a = rec.a;
+      out.b = rec.b;
+      out.wait_time = edge.getWaitTime();
+      out.weight = edge.getWeight();
+      new_state.write ( out );
+
+      interactions += out.weight;
+      if ( out.weight > 0 ) ++active;
+    }
+    new_state.close();
+    recordEdges ( timer, generated, reused, interactions, active );
+  }
+
+  if ( events_ ) addBytesWritten ( events_->close() );
+
+  if ( rename ( next_state.c_str(), stateFile().c_str() ) != 0 ){
+    throw runtime_error ( "Unable to replace edge state " + stateFile() );
+  }
+}
+
+void Network::populateEdgesStreaming ( unique_ptr < Parameters >& P, Metrics::Timer& timer ){
+  const LagSamplerCache& cache = lagCache ( P );
+
+  //Community index: communities of each vertex, by position in V_
+  //   and in C_ order. Retired ids leave gaps, so ids would overcount.
+  vector < vector < unsigned int > > coms ( V_.size() );
+  for ( unsigned int i = 0; i < C_.size(); i++ ){
+    const vset& members = C_[i]->getMembers();
+    for ( vset::const_iterator it_m = members.begin(); it_m != members.end(); it_m++ ){
+      coms[vertexSlot ( (*it_m)->getID() )].push_back ( i );
+    }
+  }
+  size_t index_bytes = coms.capacity() * sizeof ( vector < unsigned int > );
+  for ( size_t v = 0; v < coms.size(); v++ ){
+    index_bytes += coms[v].capacity() * sizeof ( unsigned int );
+  }
+  MemoryAccount::add ( MEM_MEMBERSHIP, index_bytes );
+
+  //First community the vertices at two positions of V_ share,
+  //   C_.size() if there is none
+  auto first_shared = [&] ( size_t a, size_t b ) -> unsigned int {
+    const vector < unsigned int >& x = coms[a];
+    const vector < unsigned int >& y = coms[b];
+    size_t i = 0, j = 0;
+    while ( ( i < x.size() ) && ( j < y.size() ) ){
+      if ( x[i] == y[j] ) return x[i];
+      if ( x[i] < y[j] ) ++i;
+      else ++j;
+    }
+    return C_.size();
+  };
+
+  //What one community or block of external pairs produced
+  struct Emitted {
+    string text;                                //Lines of active edges
+    vector < pair < uint64_t, double > > waits; //Every candidate
+    vector < Vertex* > ends;                    //Members of active edges
+    unsigned long reused;
+    double interactions;
+
+    Emitted ( ): reused(0), interactions(0) { }
+  };
+
+  //Weights a candidate, picking up its wait time from the last window
+  auto emit = [&] ( Emitted& out, const shared_ptr < Vertex >& A, const shared_ptr < Vertex >& B, rstream& rng ) {
+    uint64_t key = pairKey ( A->getID(), B->getID() );
+    Edge edge;
+    edge.addMember ( A );
+    edge.addMember ( B );
+
+    wait_table::const_iterator it_w = lower_bound ( waits_.begin(), waits_.end(), key, [] ( const pair < uint64_t, double >& w, uint64_t k ) { return w.first < k; } );
+    if ( ( it_w != waits_.end() ) && ( it_w->first == key ) ){
+      edge.setWaitTime ( it_w->second );
+      ++out.reused;
+    } else {
+      edge.generateWeight ( cache, rng, false ); //Initializes the edge with
+                                             //   a non-zero wait time
+    }
+    edge.generateWeight ( cache, rng, false, events_.get() );
+
+    out.waits.push_back ( make_pair ( key, edge.getWaitTime() ) );
+    double weight = edge.getWeight();
+    if ( weight > 0 ){
+      out.text += edge.toString();
+      out.ends.push_back ( A.get() );
+      out.ends.push_back ( B.get() );
+      out.interactions += weight;
+    }
+  };
+
+  //Resets edge counts for vertices
+  vector < shared_ptr < Vertex > >::iterator it_v;
+  for ( it_v = V_.begin(); it_v != V_.end(); it_v++ ){
+    (*it_v)->resetEdgeCount();
+  }
+
+  wait_table next ( ( wait_table::allocator_type ( MEM_NEW_EDGE_SET ) ) );
+  unsigned long reused = 0, active = 0;
+  double interactions = 0;
+  ofstream fout ( pendingFile().c_str() );
+
+  //Writes a batch out in order and lets go of it
+  vector < Emitted > units;
+  auto flush = [&] ( ) {
+    size_t buffered = 0;
+    for ( size_t u = 0; u < units.size(); u++ ){
+      buffered += units[u].text.capacity();
+    }
+    MemoryAccount::add ( MEM_OUTPUT, buffered );
+
+    for ( size_t u = 0; u < units.size(); u++ ){
+      fout << units[u].text;
+      next.insert ( next.end(), units[u].waits.begin(), units[u].waits.end() );
+      for ( size_t e = 0; e < units[u].ends.size(); e++ ){
+	units[u].ends[e]->incrementEdgeCount();
+      }
+      reused += units[u].reused;
+      active += units[u].ends.size() / 2;
+      interactions += units[u].interactions;
+    }
+    MemoryAccount::sub ( MEM_OUTPUT, buffered );
+    units.clear();
+  };
+
+  if ( events_ ) events_->open();
+
+  //Internal edges: communities go in batches of about batch_pairs
+  //   candidates, each drawing from its own stream
+  const double batch_pairs = 65536.0 * pool_->size();
+  unsigned int first = 0;
+  while ( first < C_.size() ){
+    unsigned int last = first;
+    double pairs = 0;
+    while ( ( last < C_.size() ) && ( ( last == first ) || ( pairs < batch_pairs ) ) ){
+      double csize = C_[last]->size();
+      pairs += csize * ( csize - 1 ) / 2;
+      ++last;
+    }
+
+    units.resize ( last - first );
+    pool_->parallelFor ( first, last, 1, [&] ( size_t lo, size_t hi ) {
+	for ( size_t i = lo; i < hi; i++ ){
+	  rstream rng ( streamSeed ( seed_, STREAM_EMIT, current_window_, com_ids_[i] ) );
+	  Emitted& out = units[i - first];
+	  visitCommunityPairs ( i, [&] ( const shared_ptr < Vertex >& A, const shared_ptr < Vertex >& B ) {
+	      if ( first_shared ( vertexSlot ( A->getID() ), vertexSlot ( B->getID() ) ) == i ) emit ( out, A, B, rng );
+	    }, [&] ( ) { return uniform ( rng ); } );
+	}
+      } );
+    flush();
+    first = last;
+  }
+  size_t internal_edges = next.size();
+  sort ( next.begin(), next.end() );
+
+  //External edges, drawn in fixed blocks. Pairs sharing a community
+  //   are internal and skipped; repeats of a pair already drawn are
+  //   dropped before they are weighted. next keeps its external part
+  //   sorted so repeats are found by binary search.
+  double mixing_parameter = P->get < double > ( "mp", 0.85 );
+  unsigned long edges_to_generate = ( (1.0 - mixing_parameter) / mixing_parameter ) * internal_edges;
+  const size_t block = 4096;
+  size_t blocks = ( edges_to_generate + block - 1 ) / block;
+  size_t per_batch = 4 * pool_->size();
+  vector < vector < pair < size_t, size_t > > > drawn;
+  vector < rstream > rngs;
+
+  for ( size_t first_block = 0; first_block < blocks; first_block += per_batch ){
+    size_t count = min ( per_batch, blocks - first_block );
+    drawn.assign ( count, vector < pair < size_t, size_t > > () );
+    rngs.resize ( count );
+
+    pool_->parallelFor ( 0, count, 1, [&] ( size_t lo, size_t hi ) {
+	for ( size_t b = lo; b < hi; b++ ){
+	  size_t g = first_block + b;
+	  rngs[b].seed ( streamSeed ( seed_, STREAM_EXTERNAL, current_window_, g ) );
+	  size_t end = min < size_t > ( edges_to_generate, ( g + 1 ) * block );
+	  for ( size_t e = g * block; e < end; e++ ){
+	    size_t x = energy_index_.sample ( uniform ( rngs[b] ) );
+	    size_t y = energy_index_.sample ( uniform ( rngs[b] ) );
+	    if ( x == y ) continue;
+	    if ( x > y ) swap ( x, y );
+	    if ( first_shared ( x, y ) < C_.size() ) continue;
+	    drawn[b].push_back ( make_pair ( x, y ) );
+	  }
+	}
+      } );
+
+    size_t batch_begin = next.size();
+    unordered_set < uint64_t > seen;
+    for ( size_t b = 0; b < count; b++ ){
+      size_t kept = 0;
+      for ( size_t e = 0; e < drawn[b].size(); e++ ){
+	uint64_t key = pairKey ( V_[drawn[b][e].first]->getID(), V_[drawn[b][e].second]->getID() );
+	if ( binary_search ( next.begin() + internal_edges, next.begin() + batch_begin, make_pair ( key, 0.0 ), [] ( const pair < uint64_t, double >& x, const pair < uint64_t, double >& y ) { return x.first < y.first; } ) ) continue;
+	if ( !seen.insert ( key ).second ) continue;
+	drawn[b][kept++] = drawn[b][e];
+      }
+      drawn[b].resize ( kept );
+    }
+
+    units.resize ( count );
+    pool_->parallelFor ( 0, count, 1, [&] ( size_t lo, size_t hi ) {
+	for ( size_t b = lo; b < hi; b++ ){
+	  for ( size_t e = 0; e < drawn[b].size(); e++ ){
+	    emit ( units[b], V_[drawn[b][e].first], V_[drawn[b][e].second], rngs[b] );
+	  }
+	}
+      } );
+    flush();
+
+    sort ( next.begin() + batch_begin, next.end() );
+    inplace_merge ( next.begin() + internal_edges, next.begin() + batch_begin, next.end() );
+  }
+  inplace_merge ( next.begin(), next.begin() + internal_edges, next.end() );
+
+  if ( events_ ) addBytesWritten ( events_->close() );
+  addBytesWritten ( fout.tellp() );
+  fout.close();
+  stream_file_ = pendingFile();
+
+  //Wait times move over to the next window; the old table goes when
+  //   next leaves scope
+  waits_.swap ( next );
+  MemoryAccount::exchange ( MEM_EDGE_SET, MEM_NEW_EDGE_SET );
+  MemoryAccount::sub ( MEM_MEMBERSHIP, index_bytes );
+
+  recordEdges ( timer, waits_.size() - reused, reused, interactions, active );
+}
+
+void Network::populateHyperedges ( unique_ptr < Parameters >& P ){
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_EDGES );
+  PerfCounters::Scope counted ( perf_.get(), perf_totals_[Metrics::PHASE_EDGES] );
+  const LagSamplerCache& cache = lagCache ( P );
+  H_.clear();
+
+  //Each batch of communities fills one set per community, appended
+  //   to H_ in C_ order once the batch is done
+  size_t per_batch = 64 * pool_->size();
+  vector < HyperedgeSet > groups;
+  for ( size_t first = 0; first < C_.size(); first += per_batch ){
+    size_t last = min < size_t > ( C_.size(), first + per_batch );
+    groups.assign ( last - first, HyperedgeSet() );
+
+    pool_->parallelFor ( first, last, 1, [&] ( size_t lo, size_t hi ) {
+	vector < Vertex* > flat, members;
+	vector < uint32_t > ids;
+	auto ignore = [] ( double ) { };
+
+	for ( size_t i = lo; i < hi; i++ ){
+	  const vset& com = C_[i]->getMembers();
+	  if ( com.size() < 2 ) continue;
+
+	  rstream rng ( streamSeed ( seed_, STREAM_HYPER, current_window_, com_ids_[i] ) );
+	  auto draw = [&rng] ( ) { return uniform ( rng ); };
+	  flat.clear();
+	  for ( vset::const_iterator it_m = com.begin(); it_m != com.end(); it_m++ ){
+	    flat.push_back ( it_m->get() );
+	  }
+
+	  size_t k = min < size_t > ( hyper_k_, flat.size() );
+	  size_t count = ceil ( hyper_rate_ * flat.size() / k );
+	  for ( size_t g = 0; g < count; g++ ){
+	    //A partial shuffle puts k distinct members up front
+	    for ( size_t j = 0; j < k; j++ ){
+	      size_t pick = min ( flat.size() - 1, j + ( size_t ) ( draw() * ( flat.size() - j ) ) );
+	      swap ( flat[j], flat[pick] );
+	    }
+	    members.assign ( flat.begin(), flat.begin() + k );
+	    sort ( members.begin(), members.end(), [] ( Vertex* a, Vertex* b ) { return a->getID() < b->getID(); } );
+
+	    //The first run only gives the new group a non-zero wait time
+	    double wait_time = 0;
+	    simulateWindow ( cache, members, wait_time, draw, ignore );
+	    double weight = simulateWindow ( cache, members, wait_time, draw, ignore );
+
+	    ids.clear();
+	    for ( size_t j = 0; j < k; j++ ){
+	      ids.push_back ( members[j]->getID() );
+	    }
+	    groups[i - first].add ( &ids[0], k, weight );
+	  }
+	}
+      } );
+
+    for ( size_t g = 0; g < groups.size(); g++ ){
+      H_.append ( groups[g] );
+    }
+  }
+  timer.items ( H_.size() );
+}
+
+void Network::streamEdgeSet ( ){
+  ofstream fout ( pendingFile().c_str() );
+  waits_.clear();
+
+  //E_ is ordered by ( a, b ), so waits_ comes out sorted
+  eset::iterator it_e;
+  for ( it_e = E_.begin(); it_e != E_.end(); it_e++ ){
+    const vset& members = (*it_e)->getMembers();
+    if ( members.size() != 2 ) continue;
+
+    fout << (*it_e)->toString();
+    waits_.push_back ( make_pair ( pairKey ( (*members.begin())->getID(), (*members.rbegin())->getID() ), (*it_e)->getWaitTime() ) );
+  }
+  addBytesWritten ( fout.tellp() );
+  fout.close();
+
+  dropEdgeSet();
+  stream_file_ = pendingFile();
+}
+
+void Network::spillEdgeSet ( ){
+  RunWriter < EdgeStateRecord > out ( stateFile() );
+  EdgeStateRecord rec;
+  
+  eset::iterator it_e;
+  for ( it_e = E_.begin(); it_e != E_.end(); it_e++ ){
+    const vset& members = (*it_e)->getMembers();
+    if ( members.size() != 2 ) continue;
+
+    rec.a = (*members.begin())->getID();
+    rec.b = (*members.rbegin())->getID();
+    rec.wait_time = (*it_e)->getWaitTime();
+    rec.weight = (*it_e)->getWeight();
+    out.write ( rec );
+  }
+  out.close();
+
+  dropEdgeSet();
+  spilled_ = true;
+}
+
+void Network::addRandomVertices ( unsigned int count ){
+  if ( count == 0 ) return;
+  
+  //Draws all of the new energies at once
+  vector < double > energies ( count );
+  for ( unsigned int i = 0; i < count; i++ ){
+    energies[i] = random_double();
+  }
+  energy_kernel_.transform ( &energies[0], &energies[0], count );
+
+  addVertices ( &energies[0], count );
+}
+
+void Network::addVertices ( const double* energies, unsigned int count ){
+  if ( count == 0 ) return;
+
+  //Each vertex is drawn from the node pool on its own, so a retired
+  //   vertex's memory is reused by later ones instead of being held
+  //   by the survivors of its window
+  V_.reserve ( V_.size() + count );
+  for ( unsigned int i = 0; i < count; i++ ){
+    V_.push_back ( allocate_shared < Vertex > ( TrackedAllocator < Vertex > ( MEM_VERTICES ), next_id_++, energies[i] ) );
+  }
+  chargeVertexIndex();
+
+  //Extends the energy index over the new vertices
+  energy_index_.append ( energies, count );
+}
+
+unsigned int Network::retireVertices ( double prob, unsigned int max_age ){
+  if ( ( prob <= 0 ) && ( max_age == 0 ) ) return 0;
+
+  //Window being built, and the window each id was added in
+  int window = current_window_ + 1;
+  //Retired ids, sorted since V_ is visited in id order
+  vector < unsigned int > retired;
+
+  for ( unsigned int i = 0; i < V_.size(); i++ ){
+    unsigned int id = V_[i]->getID();
+    int birth = upper_bound ( first_ids_.begin(), first_ids_.end(), id ) - first_ids_.begin();
+    bool too_old = ( max_age > 0 ) && ( window - birth >= ( int ) max_age );
+
+    if ( too_old || ( ( prob > 0 ) && ( random_double() < prob ) ) ){
+      retired.push_back ( id );
+    }
+  }
+  unsigned int count = retired.size();
+  if ( count == 0 ) return 0;
+
+  auto is_retired = [&] ( const shared_ptr < Vertex >& V ) { return binary_search ( retired.begin(), retired.end(), V->getID() ); };
+
+  //Memberships ( communities left empty go at the next compaction )
+  for ( unsigned int i = 0; i < C_.size(); i++ ){
+    C_[i]->removeMembersIf ( is_retired );
+  }
+
+  //Edges with a retired member
+  eset::iterator it_e = E_.begin();
+  while ( it_e != E_.end() ){
+    const vset& members = (*it_e)->getMembers();
+    if ( find_if ( members.begin(), members.end(), is_retired ) != members.end() ){
+      E_.erase ( it_e++ );
+    } else {
+      ++it_e;
+    }
+  }
+
+  //Packs the survivors down in id order and rebuilds the index.
+  //   A vertex is freed once nothing refers to it any more.
+  unsigned int kept = 0;
+  vector < double > energies;
+  energies.reserve ( V_.size() - count );
+  for ( unsigned int i = 0; i < V_.size(); i++ ){
+    if ( is_retired ( V_[i] ) ){
+      membership_.erase ( V_[i] );
+      continue;
+    }
+    energies.push_back ( V_[i]->getEnergy() );
+    V_[kept++] = V_[i];
+  }
+  V_.resize ( kept );
+
+  energy_index_.clear();
+  if ( !energies.empty() ) energy_index_.append ( &energies[0], energies.size() );
+
+  return count;
+}
+
+void Network::recordEdges ( Metrics::Timer& timer, unsigned long reused ){
+  unsigned long active = 0;
+  double interactions = 0;
+  if ( metrics_ ){
+    eset::iterator it_e;
+    for ( it_e = E_.begin(); it_e != E_.end(); it_e++ ){
+      double weight = (*it_e)->getWeight();
+      interactions += weight;
+      if ( weight > 0 ) ++active;
+    }
+  }
+  recordEdges ( timer, E_.size() - reused, reused, interactions, active );
+}
+
+void Network::recordEdges ( Metrics::Timer& timer, unsigned long generated, unsigned long reused, double interactions, unsigned long active ){
+  timer.items ( generated + reused );
+  window_edges_ = generated + reused;
+  if ( !metrics_ ) return;
+
+  metrics_->add ( Metrics::EDGES_GENERATED, generated );
+  metrics_->add ( Metrics::EDGES_REUSED, reused );
+  metrics_->add ( Metrics::INTERACTIONS, interactions );
+  metrics_->set ( Metrics::EDGES, active );
+
+  //Edges are the last step of a window
+  unsigned long empty = 0;
+  for ( unsigned int i = 0; i < C_.size(); i++ ){
+    if ( C_[i]->size() == 0 ) ++empty;
+  }
+  metrics_->set ( Metrics::VERTICES, V_.size() );
+  metrics_->set ( Metrics::COMMUNITIES_LIVE, C_.size() - empty );
+  metrics_->set ( Metrics::COMMUNITIES_EMPTY, empty );
+  metrics_->add ( Metrics::WINDOWS, 1 );
+  metrics_->write();
+}
+
+void Network::compactCommunities ( ){
+  //Shifts surviving communities ( and their ids ) down in place
+  unsigned int kept = 0;
+  for ( unsigned int i = 0; i < C_.size(); i++ ){
+    if ( C_[i]->size() == 0 ) continue;
+    
+    C_[kept] = C_[i];
+    com_ids_[kept] = com_ids_[i];
+    ++kept;
+  }
+  
+  C_.resize ( kept );
+  com_ids_.resize ( kept );
 }
 
 void Network::deathEvents ( double dprob ){
@@ -166,30 +896,50 @@ void Network::birthEvents ( double bprop ){
   //    to begin new evolutions
   int new_com = bprop * C_.size();
   for ( int i = 0; i < new_com; i++ ){
-    addCommunity ( RandomCommunity ( cpl_->Sample() ) );
+    addCommunity ( RandomCommunity ( csizes_() ) );
   }
 }
 
 void Network::growAndShrink ( double pgr, double sgr ){
-  for ( int i = 0; i < C_.size(); i++ ){
-    int new_size = C_[i]->size();
+  //Vertices each community gained, applied to membership_ afterwards
+  vector < vector < shared_ptr < Vertex > > > added ( C_.size() );
 
-    //Decides on the new size for the community
-    if ( random_double () < pgr ) {
-      new_size += (random_double ( 0, sgr ) * new_size );
-    } else { 
-      new_size -= (random_double ( 0, sgr ) * new_size );
-    }
-    
-    //Changes membership until the sizes match
-    while ( C_[i]->size() > new_size ){
-      C_[i]->removeRandomMember();
-    }
+  //Ranges split down to single communities, so a few huge 
+  //   communities do not hold up everything behind them. With one
+  //   thread the same loop runs in order on the calling thread.
+  pool_->parallelFor ( 0, C_.size(), 1, [&] ( size_t lo, size_t hi ) {
+    for ( size_t i = lo; i < hi; i++ ){
+      rstream rng ( streamSeed ( seed_, STREAM_GROW, current_window_, com_ids_[i] ) );
+      int new_size = C_[i]->size();
+
+      //Decides on the new size for the community
+      if ( uniform ( rng ) < pgr ) {
+	new_size += ( uniform ( rng, 0, sgr ) * new_size );
+      } else { 
+	new_size -= ( uniform ( rng, 0, sgr ) * new_size );
+      }
 
-    while ( C_[i]->size() < new_size ){
-      C_[i]->addMember( getRandomVertex() );
+      //Changes membership until the sizes match
+      if ( ( int ) C_[i]->size() > new_size ){
+	C_[i]->removeRandomMembers ( C_[i]->size() - new_size, rng );
+      }
+      
+      if ( ( int ) C_[i]->size() < new_size ){
+	vector < size_t > slots;
+	sampleNewMembers ( *C_[i], new_size - C_[i]->size(), [&] ( ) { return uniform ( rng ); }, slots );
+	for ( size_t j = 0; j < slots.size(); j++ ){
+	  C_[i]->addMember ( V_[slots[j]] );
+	  added[i].push_back ( V_[slots[j]] );
+	}
+      }
     }
+  } );
 
+  //Batched membership updates, in community order
+  for ( size_t i = 0; i < added.size(); i++ ){
+    for ( size_t j = 0; j < added[i].size(); j++ ){
+      membership_.insert ( pair < shared_ptr < Vertex >, int > ( added[i][j], com_ids_[i] ) );
+    }
   }
 }
 
@@ -199,41 +949,33 @@ void Network::mergeAndSplit ( double merge_prob, double split_prob, double dupli
   vector < int > merge_coms;
   
   //Goes through each community, picking out communities for 
-  //    merging and splitting others.
-  for ( int i = 0; i < C_.size(); i++ ){
+  //    merging and splitting others. Communities split off in this
+  //    pass are not considered again.
+  int num_coms = C_.size();
+  for ( int i = 0; i < num_coms; i++ ){
     double community_fate = random_double();
     
     if ( ( merge_prob > 0 ) && (community_fate < ( 1 / pow ( C_[i]->size(), merge_prob ) ) ) ){
       merge_coms.push_back ( i );
     } else if ( ( C_[i]->size() >= min_split_size) && ( community_fate < ( (merge_prob == 0) ? 0 : ( 1 / pow ( C_[i]->size(), merge_prob ) ) ) + min ( ( C_[i]->size() * split_prob ), 1.0 ) ) ){
-      fout << i << " " << i << " " << C_.size() << endl;
+      fout << com_ids_[i] << " " << com_ids_[i] << " " << next_com_id_ << endl;
       
       uint new_split_size = random_int ( 3, C_[i]->size() - 3 );
-      vector < uint > verts_saved;
+      rstream rng ( streamSeed ( seed_, STREAM_SPLIT, current_window_, com_ids_[i] ) );
       
       shared_ptr < Community > split_com ( new Community() );
-      for ( uint j = 0; j < new_split_size; j++ ){
-	if ( random_double() < duplicate_prob ){
-	  split_com->addMember( const_cast < shared_ptr < Vertex >& > ( C_[i]->getRandomMember() ) );
-	} else {
-	  split_com->addMember( C_[i]->removeRandomMember() );
-	}
-      }
+      C_[i]->splitMembers ( *split_com, new_split_size, duplicate_prob, rng );
+      addCommunity ( split_com );
     }
   }
 
   //Randomly pairs up communities for merging
   random_shuffle ( merge_coms.begin(), merge_coms.end() );
   
-  for ( uint i = 0; i < merge_coms.size() - 1; i+=2 ){
-    fout << merge_coms[i+1] << " " << merge_coms[i] << endl;
-
-    const vset old_com = C_[merge_coms[i+1]]->getMembers();
-    vset::const_iterator it_v;
-    for ( it_v = old_com.begin(); it_v != old_com.end(); it_v++ ){
-      C_[merge_coms[i]]->addMember( *it_v );
-    }
+  for ( uint i = 0; i + 1 < merge_coms.size(); i+=2 ){
+    fout << com_ids_[merge_coms[i+1]] << " " << com_ids_[merge_coms[i]] << endl;
 
+    C_[merge_coms[i]]->mergeMembers ( *C_[merge_coms[i+1]] );
     C_[merge_coms[i+1]]->clearMembers();
   }
   
@@ -241,37 +983,67 @@ void Network::mergeAndSplit ( double merge_prob, double split_prob, double dupli
 }
 
 void Network::genNextTimeWindow ( unique_ptr < Parameters >& P ){
-  //Grows network
-  double increment = random_double ( P->get < double > ( "vnewmin", 0.2 ), P->get < double > ( "vnewmax", 0.4 ) );
-  unsigned int vadd = V_.size() * increment;
-  for ( int i = 0; i < vadd; i++ ){
-    addRandomVertex();
+  {
+    Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_VERTICES );
+    PerfCounters::Scope counted ( perf_.get(), perf_totals_[Metrics::PHASE_VERTICES] );
+    unsigned int before = V_.size();
+
+    //Retires vertices first, so newcomers are never retired at birth
+    unsigned int retired = retireVertices ( P->get < double > ( "vretire", 0 ), P->get < unsigned int > ( "vmaxage", 0 ) );
+
+    //Grows network ( in steady state, only replaces retired vertices )
+    first_ids_.push_back ( next_id_ );
+    if ( P->hasFlag ( "vsteady" ) ){
+      addRandomVertices ( retired );
+    } else {
+      double increment = random_double ( P->get < double > ( "vnewmin", 0.2 ), P->get < double > ( "vnewmax", 0.4 ) );
+      addRandomVertices ( V_.size() * increment );
+    }
+
+    timer.items ( retired + ( V_.size() + retired - before ) );
+    if ( metrics_ ) metrics_->add ( Metrics::VERTICES_RETIRED, retired );
   }
   
-  //Embeds community events
-  deathEvents ( P->get < double > ( "cdie", 0.1 ) );
-  growAndShrink ( P->get < double > ( "pgrow" , 0.5 ), P->get < double > ( "maxgrow", 0.25 ) );
-  mergeAndSplit ( P->get < double > ( "pmerge", 1), P->get < double > ( "psplit", 0.01), P->get < double > ( "dup", 0.2 ),  P->get < int > ( "minsplit", 7 ), P->get < string > ( "fout", "Transition" ) + to_str < int > ( current_window_ ) + "-" + to_str < int > (current_window_+1) );
-  birthEvents ( P->get < double > ( "cnew", 0.1 ) );
+  {
+    Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_COMMUNITIES );
+    PerfCounters::Scope counted ( perf_.get(), perf_totals_[Metrics::PHASE_COMMUNITIES] );
+    timer.items ( C_.size() );
 
-  //Makes sure each vertex is still in a community
-  fillCommunities();
+    //Embeds community events
+    deathEvents ( P->get < double > ( "cdie", 0.1 ) );
+    growAndShrink ( P->get < double > ( "pgrow" , 0.5 ), P->get < double > ( "maxgrow", 0.25 ) );
+    mergeAndSplit ( P->get < double > ( "pmerge", 1), P->get < double > ( "psplit", 0.01), P->get < double > ( "dup", 0.2 ),  P->get < int > ( "minsplit", 7 ), P->get < string > ( "fout", "Transition" ) + to_str < int > ( current_window_ ) + "-" + to_str < int > (current_window_+1) );
+
+    //Drops dead and merged away communities every few windows. Off
+    //   by default: birthEvents scales with C_.size() and deathEvents
+    //   draws once per entry, so compaction changes the dynamics
+    int compact_every = P->get < int > ( "compact", 0 );
+    if ( ( compact_every > 0 ) && ( ( current_window_ + 1 ) % compact_every == 0 ) ){
+      compactCommunities();
+    }
+
+    birthEvents ( P->get < double > ( "cnew", 0.1 ) );
+
+    //Makes sure each vertex is still in a community
+    fillCommunities();
+  }
   
   //Constructs network
   populateEdges(P);
+  if ( hyper_k_ > 0 ) populateHyperedges ( P );
 
   //Incrementstracker
   ++current_window_;
 }
 
 void Network::fillCommunities (){
-  vset::iterator it_v = V_.begin();
+  vector < shared_ptr < Vertex > >::iterator it_v = V_.begin();
   
   //Adds random communities to the structure until
   //   each vertex is associated with at least one community
   while ( membership_.size() != V_.size() ){
     shared_ptr < Community > next_com ( new Community() );
-    unsigned int next_size = cpl_->Sample();
+    unsigned int next_size = csizes_();
 
     while ( ( it_v != V_.end() ) && (next_com->size() < next_size ) ){
       if ( membership_.find (*it_v) == membership_.end() ){
@@ -281,8 +1053,10 @@ void Network::fillCommunities (){
     }
     
     if ( ( it_v == V_.end() ) && ( next_com->size() < next_size ) ){
-      while ( next_com->size() < next_size ){
-	next_com->addMember ( getRandomVertex () );
+      vector < size_t > slots;
+      sampleNewMembers ( *next_com, next_size - next_com->size(), [] ( ) { return random_double(); }, slots );
+      for ( size_t i = 0; i < slots.size(); i++ ){
+	next_com->addMember ( V_[slots[i]] );
       }
     }
     
@@ -291,15 +1065,327 @@ void Network::fillCommunities (){
 }
 
 void Network::printNetwork ( string filename ){
+  //A streamed window is on disk already ( and counted in the
+  //   metrics ) and only needs its name. Copies when the spill
+  //   directory is on another file system.
+  if ( streaming_ ){
+    if ( filename == stream_file_ ) return;
+    if ( rename ( stream_file_.c_str(), filename.c_str() ) != 0 ){
+      ifstream fin ( stream_file_.c_str(), ios::binary );
+      ofstream fout ( filename.c_str(), ios::binary );
+      fout << fin.rdbuf();
+      fin.close();
+      fout.close();
+      remove ( stream_file_.c_str() );
+    }
+    stream_file_ = filename;
+    return;
+  }
+
+  if ( shards_ > 1 ){
+    printNetworkSharded ( filename );
+    return;
+  }
+
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_OUTPUT );
   ofstream fout ( filename.c_str() );
+
+  //Edges of a spilled network are streamed from the state table
+  if ( spilled_ ){
+    RunReader < EdgeStateRecord > state ( stateFile() );
+    EdgeStateRecord rec;
+    while ( state.next ( rec ) ){
+      if ( rec.weight > 0 )
+	fout << rec.a << "|" << rec.b << "|" << to_str < double > ( rec.weight ) << "\n";
+    }
+    closeOutput ( fout, timer );
+    return;
+  }
   
   eset::iterator it_e;
   //If the edge representation is not empty ( 0-weight edge )
   //    print the string representation to the file provided
-  for ( it_e = E_.begin(); it_e != E_.end(); it_e++ ){
-    if ( ( (*it_e)->toString() ).size() > 0 )
+  if ( pool_->serial() ){
+    for ( it_e = E_.begin(); it_e != E_.end(); it_e++ ){
       fout << (*it_e)->toString();
+    }
+    closeOutput ( fout, timer );
+    return;
   }
+
+  //In parallel, a batch of blocks is formatted at once and the
+  //    blocks are written out in order
+  const size_t block = 4096;
+  size_t batch = block * 4 * pool_->size();
+  vector < Edge* > edges;
+  vector < string > text;
+  edges.reserve ( batch );
   
+  it_e = E_.begin();
+  while ( it_e != E_.end() ){
+    edges.clear();
+    for ( ; ( it_e != E_.end() ) && ( edges.size() < batch ); it_e++ ){
+      edges.push_back ( it_e->get() );
+    }
+
+    text.assign ( ( edges.size() + block - 1 ) / block, string() );
+    pool_->parallelFor ( 0, text.size(), 1, [&] ( size_t lo, size_t hi ) {
+	for ( size_t b = lo; b < hi; b++ ){
+	  size_t end = min ( edges.size(), ( b + 1 ) * block );
+	  for ( size_t e = b * block; e < end; e++ ){
+	    text[b] += edges[e]->toString();
+	  }
+	}
+      } );
+
+    size_t buffered = 0;
+    for ( size_t b = 0; b < text.size(); b++ ){
+      buffered += text[b].capacity();
+    }
+    MemoryAccount::add ( MEM_OUTPUT, buffered );
+
+    for ( size_t b = 0; b < text.size(); b++ ){
+      fout << text[b];
+    }
+    MemoryAccount::sub ( MEM_OUTPUT, buffered );
+  }
+  
+  closeOutput ( fout, timer );
+}
+
+void Network::printNetworkSharded ( string filename ){
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_OUTPUT );
+
+  //Parts and manifest are named after the file, without extension
+  string base = filename;
+  size_t dot = base.find_last_of ( '.' );
+  if ( ( dot != string::npos ) && ( base.find ( '/', dot ) == string::npos ) ) base.erase ( dot );
+
+  //Spilled state is a fixed size record array, so shards just map
+  //   their slice of it. In memory, shards are slices of E_.
+  unique_ptr < MappedFile > state;
+  const EdgeStateRecord* records = NULL;
+  vector < Edge* > edges;
+  size_t total;
+  if ( spilled_ ){
+    state.reset ( new MappedFile ( stateFile() ) );
+    records = reinterpret_cast < const EdgeStateRecord* > ( state->data() );
+    total = state->size() / sizeof ( EdgeStateRecord );
+  } else {
+    edges.reserve ( E_.size() );
+    for ( eset::iterator it_e = E_.begin(); it_e != E_.end(); it_e++ ){
+      edges.push_back ( it_e->get() );
+    }
+    total = edges.size();
+  }
+
+  //What each shard wrote, for the manifest
+  struct Shard {
+    string file;
+    unsigned long lines;
+    unsigned long bytes;
+    string first;
+    string last;
+  };
+  vector < Shard > shards ( shards_ );
+
+  pool_->parallelFor ( 0, shards_, 1, [&] ( size_t lo, size_t hi ) {
+      for ( size_t s = lo; s < hi; s++ ){
+	char suffix[16];
+	snprintf ( suffix, sizeof ( suffix ), ".part-%02u", ( unsigned int ) s );
+	Shard& shard = shards[s];
+	shard.file = base + suffix;
+	shard.lines = 0;
+	shard.bytes = 0;
+
+	ofstream fout ( shard.file.c_str() );
+	string text;
+	text.reserve ( ( 1 << 20 ) + 4096 );
+	size_t charged = text.capacity();
+	MemoryAccount::add ( MEM_OUTPUT, charged );
+	size_t begin = total * s / shards_, end = total * ( s + 1 ) / shards_;
+	for ( size_t e = begin; e < end; e++ ){
+	  string lines;
+	  if ( records ){
+	    if ( records[e].weight > 0 ){
+	      lines = to_str < unsigned int > ( records[e].a ) + "|" + to_str < unsigned int > ( records[e].b ) + "|" + to_str < double > ( records[e].weight ) + "\n";
+	    }
+	  } else {
+	    lines = edges[e]->toString();
+	  }
+	  if ( lines.empty() ) continue;
+
+	  //Boundaries are the first and last pair written
+	  if ( shard.lines == 0 ) shard.first = lines.substr ( 0, lines.find ( '|', lines.find ( '|' ) + 1 ) );
+	  shard.last = lines.substr ( lines.rfind ( '\n', lines.size() - 2 ) + 1 );
+	  shard.last = shard.last.substr ( 0, shard.last.rfind ( '|' ) );
+	  shard.lines += count ( lines.begin(), lines.end(), '\n' );
+
+	  text += lines;
+	  if ( text.size() > ( 1 << 20 ) ){
+	    fout << text;
+	    text.clear();
+	  }
+	}
+	fout << text;
+	MemoryAccount::sub ( MEM_OUTPUT, charged );
+	shard.bytes = fout.tellp();
+	fout.close();
+      }
+    } );
+
+  //Manifest: one line per part with its boundaries and counts
+  ofstream manifest ( ( base + ".manifest" ).c_str() );
+  unsigned long lines = 0, bytes = 0;
+  for ( unsigned int s = 0; s < shards_; s++ ){
+    lines += shards[s].lines;
+    bytes += shards[s].bytes;
+  }
+  manifest << "shards " << shards_ << "\n";
+  manifest << "edges " << lines << "\n";
+  for ( unsigned int s = 0; s < shards_; s++ ){
+    manifest << shards[s].file << " " << shards[s].lines << " " << shards[s].bytes << " ";
+    if ( shards[s].lines > 0 ){
+      manifest << shards[s].first << " " << shards[s].last << "\n";
+    } else {
+      manifest << "- -\n";
+    }
+  }
+  addBytesWritten ( bytes );
+  timer.items ( bytes );
+  closeOutput ( manifest, timer );
+}
+
+void Network::printHyperedges ( string filename ){
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_OUTPUT );
+  ofstream fout ( filename.c_str() );
+
+  //Like printNetwork: a batch of blocks is formatted at once and the
+  //    blocks are written out in order
+  const size_t block = 4096;
+  size_t batch = block * 4 * pool_->size();
+  vector < string > text;
+  for ( size_t first = 0; first < H_.size(); first += batch ){
+    size_t last = min ( H_.size(), first + batch );
+    text.assign ( ( last - first + block - 1 ) / block, string() );
+    pool_->parallelFor ( 0, text.size(), 1, [&] ( size_t lo, size_t hi ) {
+	for ( size_t b = lo; b < hi; b++ ){
+	  H_.format ( first + b * block, min ( last, first + ( b + 1 ) * block ), hyper_out_, text[b] );
+	}
+      } );
+
+    size_t buffered = 0;
+    for ( size_t b = 0; b < text.size(); b++ ){
+      buffered += text[b].capacity();
+    }
+    MemoryAccount::add ( MEM_OUTPUT, buffered );
+
+    for ( size_t b = 0; b < text.size(); b++ ){
+      fout << text[b];
+    }
+    MemoryAccount::sub ( MEM_OUTPUT, buffered );
+  }
+
+  closeOutput ( fout, timer );
+}
+
+void Network::publishWindow ( ){
+  if ( !shm_ ) return;
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_OUTPUT );
+
+  shm_->beginWindow ( current_window_ );
+  visitEdges ( [&] ( unsigned int a, unsigned int b, double w ) { shm_->push ( a, b, w ); } );
+  timer.items ( shm_->endWindow() );
+}
+
+void Network::printIndex ( string filename ){
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_OUTPUT );
+
+  vector < BinaryEdgeRecord > edges;
+  visitEdges ( [&] ( unsigned int a, unsigned int b, double w ) {
+      BinaryEdgeRecord rec;
+      rec.a = a;
+      rec.b = b;
+      rec.weight = w;
+      edges.push_back ( rec );
+    } );
+
+  unsigned long bytes = writeEdgeIndex ( filename, edges, *pool_ );
+  timer.items ( bytes );
+  addBytesWritten ( bytes );
+}
+
+void Network::reportMemory ( ){
+  if ( !memlog_ ) return;
+
+  MemoryAccount::sync();
+  long current[MEM_TAGS], peak[MEM_TAGS];
+  for ( unsigned int t = 0; t < MEM_TAGS; t++ ){
+    current[t] = MemoryAccount::current ( ( MemTag ) t );
+    peak[t] = MemoryAccount::peak ( ( MemTag ) t );
+  }
+  MemoryAccount::resetPeaks();
+
+  cout << "Memory ( MB, current/peak ) window " << current_window_ << ":";
+  for ( unsigned int t = 0; t < MEM_TAGS; t++ ){
+    MemTag tag = ( MemTag ) t;
+    cout << " " << MemoryAccount::name ( tag ) << " " << to_str < double > ( current[t] / 1048576.0 ) << "/" << to_str < double > ( peak[t] / 1048576.0 );
+    *memlog_ << current_window_ << "\t" << MemoryAccount::name ( tag ) << "\t" << current[t] << "\t" << peak[t] << "\n";
+  }
+  cout << endl;
+  memlog_->flush();
+}
+
+void Network::reportProfile ( ){
+  if ( !perf_ ) return;
+
+  cout << "Profile window " << current_window_ << " ( " << window_edges_ << " edges ):";
+  for ( unsigned int p = 0; p < Metrics::PHASE_OUTPUT; p++ ){
+    uint64_t* counts = perf_totals_[p];
+    const char* phase = Metrics::phaseName ( ( Metrics::Phase ) p );
+
+    //Derived values need both of their counters
+    string values[PerfCounters::NUM_EVENTS], ipc = "-", cache = "-", branch = "-";
+    for ( int e = 0; e < PerfCounters::NUM_EVENTS; e++ ){
+      values[e] = perf_->available ( ( PerfCounters::Event ) e ) ? to_str < uint64_t > ( counts[e] ) : "-";
+    }
+    if ( perf_->available ( PerfCounters::CYCLES ) && perf_->available ( PerfCounters::INSTRUCTIONS ) && ( counts[PerfCounters::CYCLES] > 0 ) ){
+      ipc = to_str < double > ( ( double ) counts[PerfCounters::INSTRUCTIONS] / counts[PerfCounters::CYCLES] );
+    }
+    if ( window_edges_ > 0 ){
+      if ( perf_->available ( PerfCounters::CACHE_MISSES ) ) cache = to_str < double > ( ( double ) counts[PerfCounters::CACHE_MISSES] / window_edges_ );
+      if ( perf_->available ( PerfCounters::BRANCH_MISSES ) ) branch = to_str < double > ( ( double ) counts[PerfCounters::BRANCH_MISSES] / window_edges_ );
+    }
+
+    cout << " " << phase << " IPC " << ipc << " cache/edge " << cache << " branch/edge " << branch << ";";
+    *profile_ << current_window_ << "\t" << phase;
+    for ( int e = 0; e < PerfCounters::NUM_EVENTS; e++ ){
+      *profile_ << "\t" << values[e];
+    }
+    *profile_ << "\t" << ipc << "\t" << cache << "\t" << branch << "\n";
+  }
+  cout << endl;
+  profile_->flush();
+
+  memset ( perf_totals_, 0, sizeof ( perf_totals_ ) );
+}
+
+void Network::printCommunities ( string filename ){
+  Metrics::Timer timer ( metrics_.get(), Metrics::PHASE_OUTPUT );
+  ofstream fout ( filename.c_str() );
+
+  for ( unsigned int i = 0; i < C_.size(); i++ ){
+    if ( C_[i]->size() > 0 )
+      fout << com_ids_[i] << " " << C_[i]->toString() << "\n";
+  }
+
+  closeOutput ( fout, timer );
+}
+
+void Network::closeOutput ( ofstream& fout, Metrics::Timer& timer ){
+  unsigned long bytes = fout.tellp();
   fout.close();
+
+  timer.items ( bytes );
+  addBytesWritten ( bytes );
 }
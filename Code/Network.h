@@ -29,14 +29,29 @@
 #include "Vertex.h"
 #include "Community.h"
 #include "Edge.h"
+#include "ExternalSort.h"
+#include "EnergySampler.h"
+#include "InversePowerLaw.h"
+#include "InteractionModel.h"
+#include "RandomStream.h"
+#include "ThreadPool.h"
+#include "Loader.h"
+#include "EdgeIndex.h"
+#include "Hyperedge.h"
+#include "ShmRing.h"
+#include "EventStream.h"
+#include "Metrics.h"
+#include "PerfCounters.h"
 #include "../../Libraries/Random/PowerLaw.h"
 #include "../../Libraries/Random/Wrappers.h"
 #include "../../Libraries/Params/Parameters.h"
 #include <set>
+#include <unordered_set>
 #include <tr1/memory>
 #include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <cstring>
 
 using namespace std;
 
@@ -60,28 +75,84 @@ using namespace std;
 class Network{
  public:
   /**
-   *@fn Network ( unique_ptr < Parameters >& P ): next_id_(0), vpl_( new PowerLaw ( -P->get < double > ( "vexp" ), P->get < double > ( "vmin" ), P->get < double > ( "vmax" ) ) )
+   *@fn Network ( unique_ptr < Parameters >& P )
    *
-   * Initializes a certain number of vertices by assigning them an
-   *    energy value based off of the given parameters for the
-   *    power law. Default power law values result in a NULL object
-   *    for use when analyzing exitsing networks (and vpl_ becomes 
-   *    unnecessary).
+   * Sets up an empty network. New vertices draw their energies from
+   *    the power law with exponent -vexp on [vmin, vmax] through
+   *    energy_kernel_.
    *
    *@param P See README for description of parameters
    */
-  Network ( unique_ptr < Parameters >& P ): total_energy_(0), next_id_(0), vpl_( new PowerLaw ( -P->get < double > ( "vexp", 1.75 ), P->get < double > ( "vmin", 0.4 ), P->get < double > ( "vmax", 1 ) ) ), cpl_( new PowerLaw ( -(P->get < double > ( "cexp", 2.75 ) ), P->get < double > ("cmin", 3), P->get<double>("cmax", 55) ) ), current_window_(0){
-    if ( vpl_->getExp() > 0) { 
-      cerr << "Setting vertex energy power law to NULL. Set -vexp to change." << endl;
-      vpl_ = NULL;
+  Network ( unique_ptr < Parameters >& P ):
+    next_com_id_(0),
+    E_ ( cmp_pedge(), eset::allocator_type ( MEM_EDGE_SET ) ),
+    membership_ ( cmp_vptr(), membership_map::allocator_type ( MEM_MEMBERSHIP ) ),
+    next_id_(0),
+    csizes_ ( P ),
+    lag_cache_ ( new LagSamplerCache ( P ) ),
+    current_window_(0),
+    mem_budget_ ( P->get < double > ( "membudget", 0 ) * 1048576.0 ),
+    spill_dir_ ( P->get < string > ( "spilldir", "." ) ),
+    spill_prefix_ ( spillPrefix ( spill_dir_ ) ),
+    spilled_(false),
+    energy_kernel_ ( -P->get < double > ( "vexp", 1.75 ), P->get < double > ( "vmin", 0.4 ), P->get < double > ( "vmax", 1 ) ),
+    seed_ ( P->get < unsigned int > ( "seed", time ( NULL ) ) ),
+    threads_ ( max ( P->get < int > ( "threads", 1 ), 1 ) ),
+    skip_size_ ( P->get < unsigned int > ( "skipsize", 0 ) ),
+    skip_density_ ( P->get < double > ( "skipdens", 0.1 ) ),
+    shards_ ( max ( P->get < int > ( "shards", 1 ), 1 ) ),
+    vertex_index_bytes_(0),
+    streaming_ ( P->hasFlag ( "stream" ) ),
+    waits_ ( wait_table::allocator_type ( MEM_EDGE_SET ) ),
+    hyper_k_ ( P->get < unsigned int > ( "hyper", 0 ) ),
+    hyper_rate_ ( P->get < double > ( "hyperrate", 1 ) ),
+    hyper_out_ ( ( HyperedgeSet::Output ) LagSamplerCache::modelIndex ( P, "hyperout", HyperedgeSet::outputNames(), 2 ) ),
+    window_edges_(0) {
+    srand ( seed_ );
+
+    //Counters are opened first so the pool's threads inherit them
+    memset ( perf_totals_, 0, sizeof ( perf_totals_ ) );
+    if ( P->hasFlag ( "profile" ) ){
+      perf_.reset ( new PerfCounters() );
+      if ( !perf_->available() ){
+	cerr << "Hardware counters unavailable ( " << perf_->error() << " ); -profile ignored." << endl;
+	perf_.reset();
+      } else {
+	if ( !perf_->error().empty() ) cerr << "Some hardware counters unavailable ( " << perf_->error() << " ); reported as -." << endl;
+	profile_.reset ( new ofstream ( P->get < string > ( "profile" ).c_str() ) );
+	*profile_ << "window\tphase\tcycles\tinstructions\tcache_misses\tbranch_misses\tipc\tcache_misses_per_edge\tbranch_misses_per_edge\n";
+      }
+    }
+    pool_.reset ( new ThreadPool ( threads_ ) );
+    if ( P->hasFlag ( "metrics" ) ){
+      metrics_.reset ( new Metrics ( P->get < string > ( "metrics" ), P->get < double > ( "metricsint", 5 ) ) );
+    }
+    if ( P->hasFlag ( "events" ) ){
+      events_.reset ( new EventStream ( P->get < string > ( "eventsout", "Events" ), spill_prefix_, P->get < unsigned int > ( "eventbuf", 1 << 20 ), *pool_ ) );
+    }
+    if ( P->hasFlag ( "shm" ) ){
+      shm_.reset ( new ShmRingWriter ( P->get < string > ( "shm" ), P->get < unsigned int > ( "shmslots", 4 ), P->get < double > ( "shmslotmb", 16 ) * 1048576.0 ) );
+    }
+    if ( P->hasFlag ( "memlog" ) ){
+      if ( MemoryAccount::enabled() ){
+	memlog_.reset ( new ofstream ( P->get < string > ( "memlog" ).c_str() ) );
+	*memlog_ << "window\ttag\tcurrent_bytes\tpeak_bytes\n";
+      } else {
+	cerr << "Memory accounting was compiled out ( RPI_NO_MEMTRACK ); -memlog ignored." << endl;
+      }
     }
-    srand ( time ( NULL ) );
   }
 
   /**
    *@fn ~Network()
+   *
+   * Removes the on-disk edge state if the network was spilled, and
+   * a streamed edge list that was never printed.
    */
-  ~Network(){};
+  ~Network(){
+    if ( spilled_ ) remove ( stateFile().c_str() );
+    if ( streaming_ && ( stream_file_ == pendingFile() ) ) remove ( stream_file_.c_str() );
+  };
 
   /**
    *@fn RandomNetwork ( unique_ptr < Parameters >& P )
@@ -94,6 +165,23 @@ class Network{
    */
   void RandomNetwork ( unique_ptr < Parameters >& P );
 
+  /**
+   *@fn void loadNetwork ( unique_ptr < Parameters >& P )
+   *
+   *  Alternative to RandomNetwork: seeds the first window from an
+   *existing edge list ( -in, binary with -inbin ) and, optionally, a
+   *community cover ( -incom ) and vertex energies ( -inenergy ). Files
+   *are memory-mapped and parsed on the thread pool. Vertex ids run
+   *from 0 to the largest id seen. Without -inenergy, energies are
+   *taken proportional to observed degree, scaled so the highest degree
+   *gets vmax ( and clamped at vmin ). Vertices left out of the cover
+   *are placed by fillCommunities as usual. Expects a network with no
+   *vertices yet.
+   *
+   *@param P Object holding parameters for model
+   */
+  void loadNetwork ( unique_ptr < Parameters >& P );
+
   /**
    *@fn shared_ptr < Community > RandomCommunity
    *
@@ -110,14 +198,35 @@ class Network{
    *
    *    Outputs a representation of the community structure of the
    * network to standard output. Each community's string
-   * representation begins on a fresh line.
+   * representation begins on a fresh line, after its id.
    */
   void printCommunities(){
     for ( int i = 0; i < C_.size(); i++ ){
-      cout << C_[i]->toString() << endl;
+      cout << com_ids_[i] << " " << C_[i]->toString() << endl;
     }
   }
 
+  /**
+   *@fn void printCommunities ( string filename )
+   *
+   *    Writes the ground truth community structure to a file, one
+   * 'id ( members )' line per non-empty community. Ids are the
+   * same ones used in the transition files.
+   *
+   *@param filename File to print communities to
+   */
+  void printCommunities ( string filename );
+
+  /**
+   *@fn unsigned int NumCommunities ( )
+   *
+   *@return Number of communities currently held, including empty
+   *         ones that have not been compacted yet
+   */
+  unsigned int NumCommunities ( ){
+    return C_.size();
+  }
+
   /**
    *@fn void printEdges ()
    *
@@ -147,6 +256,16 @@ class Network{
    * one community, and a specified number of noise edges. Runs
    * a random process to determine the weights on each edge.
    *
+   *    With -events, every simulated interaction is also written to
+   * the window's event file ( see EventStream ).
+   *
+   *    If a memory budget is set ( -membudget, in MB ) and the
+   * estimated size of the edge structure exceeds it, the work is
+   * handed to populateEdgesExternal instead.
+   *
+   *    With -stream, edges are never held as a set: see
+   * populateEdgesStreaming.
+   *
    *@param P Parameters for the model ( usually from the command line)
    */
   void populateEdges ( unique_ptr < Parameters >& P );
@@ -159,7 +278,7 @@ class Network{
    *  to standard out. Used for debugging purposes.
    */
   void printVertices() {
-    set < shared_ptr < Vertex > >::iterator it_v;
+    vector < shared_ptr < Vertex > >::iterator it_v;
     
     for ( it_v = V_.begin(); it_v != V_.end(); it_v++ ){
       cout << (*it_v)->toString() << " : " << (*it_v)->getEnergy() <<  endl;
@@ -177,13 +296,22 @@ class Network{
     return V_.size();
   }
 
+  /**
+   *@fn const vector < shared_ptr < Vertex > >& getVertices ( )
+   *
+   *@return Vertices of the network in id order
+   */
+  const vector < shared_ptr < Vertex > >& getVertices ( ){
+    return V_;
+  }
+
   /**
    *void printVerts()
    *
    *  Prints the names of vertices ( one per line ) to standard out
    */
   void printVerts(){
-    vset::iterator it_v = V_.begin(); 
+    vector < shared_ptr < Vertex > >::iterator it_v = V_.begin(); 
     while ( it_v != V_.end() ){
       cout << (*it_v)->toString() << " ";
 
@@ -198,10 +326,71 @@ class Network{
    *   Prints the edge list for the network, one edge string
    * representation on each newline, to the given file.
    *
+   *   With -shards N above 1, the list is written in N parts by
+   * printNetworkSharded instead.
+   *
+   *   A streamed window ( -stream ) was already written while its
+   * edges were generated; the file is only moved to filename, and
+   * -shards does not apply.
+   *
    *@param filename File to print network to
    */
   void printNetwork ( string filename );
 
+  /**
+   *@fn void printHyperedges ( string filename )
+   *
+   *   Writes the window's hyperedges ( -hyper ) with a positive
+   * weight: one 'a|b|...|weight' line per group, or with -hyperout
+   * clique one 'a|b|weight' line per pair of members. Blocks of
+   * groups are formatted on the pool and written in order.
+   *
+   *@param filename File to print hyperedges to
+   */
+  void printHyperedges ( string filename );
+
+  /**
+   *@fn void publishWindow ( )
+   *
+   *   With -shm, hands the window's edges, in printNetwork order, to
+   * the consumer of the shared memory ring ( see ShmRing.h ). Waits
+   * while the ring is full.
+   */
+  void publishWindow ( );
+
+  /**
+   *@fn void printIndex ( string filename )
+   *
+   *   Writes the random-access index ( see EdgeIndex.h ) of the edges
+   * printNetwork writes for this window.
+   *
+   *@param filename File to write the index to
+   */
+  void printIndex ( string filename );
+
+  /**
+   *@fn void reportMemory ( )
+   *
+   *   With -memlog, logs the current and peak bytes of each memory
+   * tag ( see MemoryAccount.h ) since the last report, and appends
+   * them to the summary file as 'window tag current peak' rows. Peaks
+   * then restart, so each report covers one window and its output.
+   */
+  void reportMemory ( );
+
+  /**
+   *@fn void reportProfile ( )
+   *
+   *   With -profile, logs the hardware counters of each generation
+   * phase ( vertices, communities, edges ) since the last report,
+   * with instructions per cycle and cache and branch misses per
+   * candidate edge of the window, and appends them to the summary
+   * file as 'window phase cycles instructions cache_misses
+   * branch_misses ipc cache_misses_per_edge branch_misses_per_edge'
+   * rows ( '-' for counters that are not available ).
+   */
+  void reportProfile ( );
+
   /**
    *@fn void addRandomVertex ()
    *
@@ -209,7 +398,19 @@ class Network{
    *    current maximum. Also generates an energy value for the 
    *    vertex.
    */
-  void addRandomVertex ( );
+  void addRandomVertex ( ) { addRandomVertices ( 1 ); }
+
+  /**
+   *@fn void addRandomVertices ( unsigned int count )
+   *
+   * Bulk version of addRandomVertex. All energies are drawn in one
+   *    pass of the inverse-CDF kernel, the vertices are appended to
+   *    V_ together, and the energy index is extended once for the
+   *    whole batch.
+   *
+   *@param count Number of vertices to add
+   */
+  void addRandomVertices ( unsigned int count );
   /**
    * @fn void genNextTimeWindow( unique_ptr < Parameters >& P )
    *
@@ -221,6 +422,85 @@ class Network{
    */
   void genNextTimeWindow( unique_ptr < Parameters >& P );
 
+  /**
+   *@fn void visitEdges ( F f )
+   *
+   *  Calls f ( a, b, weight ) for every pair of vertex ids joined by
+   * an edge with a positive weight in the current window, in the same
+   * order printNetwork writes them: by ( a, b ), or community order
+   * for a streamed window. Nothing is copied for in-memory
+   * edges; a spilled network streams its on-disk table instead, and a
+   * streamed one parses its edge list back from a mapping of the file,
+   * one edge at a time.
+   *
+   *@param f Callable taking ( unsigned int, unsigned int, double )
+   */
+  template < class F >
+  void visitEdges ( F f ){
+    if ( streaming_ ){
+      EdgeListReader edges ( stream_file_ );
+      BinaryEdgeRecord rec;
+      while ( edges.next ( rec ) ){
+	f ( rec.a, rec.b, rec.weight );
+      }
+      return;
+    }
+
+    if ( spilled_ ){
+      RunReader < EdgeStateRecord > state ( stateFile() );
+      EdgeStateRecord rec;
+      while ( state.next ( rec ) ){
+	if ( rec.weight > 0 ) f ( rec.a, rec.b, rec.weight );
+      }
+      return;
+    }
+
+    eset::const_iterator it_e;
+    vset::const_iterator it_a, it_b;
+    for ( it_e = E_.begin(); it_e != E_.end(); it_e++ ){
+      double weight = (*it_e)->getWeight();
+      if ( weight == 0 ) continue;
+
+      const vset& members = (*it_e)->getMembers();
+      for ( it_a = members.begin(); it_a != members.end(); it_a++ ){
+	it_b = it_a;
+	for ( ++it_b; it_b != members.end(); it_b++ ){
+	  f ( (*it_a)->getID(), (*it_b)->getID(), weight );
+	}
+      }
+    }
+  }
+
+  /**
+   *@fn void visitCommunities ( F f )
+   *
+   *  Calls f ( id, members ) for every non-empty community, where id
+   * is the stable community id and members is the community's own
+   * member set ( by reference ).
+   *
+   *@param f Callable taking ( unsigned int, const vset& )
+   */
+  template < class F >
+  void visitCommunities ( F f ){
+    for ( unsigned int i = 0; i < C_.size(); i++ ){
+      if ( C_[i]->size() > 0 ) f ( com_ids_[i], C_[i]->getMembers() );
+    }
+  }
+
+  /**
+   *@fn ThreadPool& pool ( )
+   *
+   *@return Thread pool shared by all parallel phases ( -threads )
+   */
+  ThreadPool& pool ( ) { return *pool_; }
+
+  /**
+   *@fn int getWindow ( )
+   *
+   *@return Index of the window currently held by the network
+   */
+  int getWindow ( ) { return current_window_; }
+
   /**
    *@fn shared_ptr < Vertex > getRandomVertex ( )
    *
@@ -232,56 +512,416 @@ class Network{
    *@return Pointer to a random vertex in the network
    */
   shared_ptr < Vertex > getRandomVertex ( ){
-    //Gets random energy
-    double energy_seen = 0;
-    double random_target = random_double() * total_energy_;
-    
-    //Iterates through vertices until energy is hit
-    //   Vertex at that spot is returned.
-    vset::iterator it_v = V_.begin();
-    while ( ( energy_seen < random_target ) && (it_v != V_.end()) ){
-      energy_seen += (*it_v)->getEnergy();
-      if ( energy_seen > random_target ){
-	return *it_v;
-      }
-      ++it_v;
-    }
-    
-    return (*(V_.begin()));
+    //Finds the vertex whose slice of the total energy holds
+    //   a random target
+    return V_[energy_index_.sample ( random_double() )];
   }
 
  private:
-  set < shared_ptr < Vertex >, cmp_vptr > V_;              //Vertex structure
+  vector < shared_ptr < Vertex > > V_;       //Vertex structure ( id order )
   vector < shared_ptr < Community > > C_;     //Community structure
+  vector < unsigned int > com_ids_;   //Stable id of each entry of C_
+  unsigned int next_com_id_;          //Id for the next new community
   eset E_;                        //Edges of network
-  //Map to track which vertices are in which communities
-  map < shared_ptr < Vertex >, int, cmp_vptr > membership_; 
+  //Map to track which vertices are in which communities ( by id )
+  typedef map < shared_ptr < Vertex >, int, cmp_vptr, TrackedAllocator < pair < const shared_ptr < Vertex >, int > > > membership_map;
+  membership_map membership_; 
   unsigned int next_id_;          //Largest id
-  double total_energy_;           //Sum of vertex energies
-  unique_ptr < PowerLaw > vpl_;   //Power law for energy values
-  unique_ptr < PowerLaw > cpl_;   //Communty sizes
+  EnergySampler energy_index_;    //Running energy sums over V_
+  CommunitySizes csizes_;        //Communty sizes
+  unique_ptr < LagSamplerCache > lag_cache_; //Interaction model and
+                                  //   wait time samplers ( see lagCache )
   
   int current_window_;
 
+  double mem_budget_;             //Bytes allowed for the edge structure
+                                  //   ( 0 means no limit )
+  string spill_dir_;              //Directory for spilled edge state
+  string spill_prefix_;           //Path prefix of this network's files
+                                  //   in spill_dir_ ( see spillPrefix )
+  bool spilled_;                  //True once edge state lives on disk
+                                  //   instead of in E_
+  InversePowerLaw energy_kernel_; //Bulk sampler for vertex energies
+  unsigned int seed_;             //Seed for rand() and random streams
+  int threads_;                   //Worker threads for parallel phases
+  unique_ptr < ThreadPool > pool_;//Shared by every parallel phase
+  unsigned int skip_size_;        //Communities at least this large get
+                                  //   sampled pairs ( 0 = never )
+  double skip_density_;           //Share of pairs kept when sampling
+  unsigned int shards_;           //Parts each edge list is written in
+  unique_ptr < EventStream > events_; //Interaction output ( -events )
+  unique_ptr < Metrics > metrics_;  //Live metrics file ( -metrics )
+  vector < unsigned int > first_ids_; //First id added in each window
+                                  //   after the first ( gives ages )
+  size_t vertex_index_bytes_;     //Capacity of V_ charged to MEM_VERTICES
+  unique_ptr < ofstream > memlog_;//Per-window memory summary ( -memlog )
+  bool streaming_;                //Edges written as they are generated
+                                  //   ( -stream )
+  string stream_file_;            //Edge list of the current window
+                                  //   when streaming
+  //Wait time of each candidate pair of the window by pairKey, sorted.
+  //   Carries edge state between windows when streaming.
+  typedef vector < pair < uint64_t, double >, TrackedAllocator < pair < uint64_t, double > > > wait_table;
+  wait_table waits_;
+  unsigned int hyper_k_;          //Members per hyperedge ( 0 = none )
+  double hyper_rate_;             //Hyperedges each member takes part
+                                  //   in, on average
+  HyperedgeSet::Output hyper_out_;//Format of the hyperedge files
+  HyperedgeSet H_;                //Hyperedges of the window ( -hyper )
+  unique_ptr < ShmRingWriter > shm_; //Window ring for a consumer ( -shm )
+  unique_ptr < PerfCounters > perf_;//Hardware counters ( -profile )
+  uint64_t perf_totals_[Metrics::NUM_PHASES][PerfCounters::NUM_EVENTS]; //Counts
+                                  //   of each phase since the last report
+  unsigned long window_edges_;    //Candidate edges of the window
+  unique_ptr < ofstream > profile_;//Per-window counter summary ( -profile )
+
+  //Rough footprint of a single Edge held in E_ and new_edge_set:
+  //   set node, shared_ptr control block, the Edge itself and the
+  //   two nodes of its member set.
+  static const unsigned int EDGE_BYTES = 300;
+
+  /**
+   *@fn void chargeVertexIndex ( )
+   *
+   *   Brings the MEM_VERTICES charge for V_ in line with its capacity.
+   * Called wherever V_ grows or is packed.
+   */
+  void chargeVertexIndex ( ){
+    size_t bytes = V_.capacity() * sizeof ( shared_ptr < Vertex > );
+    if ( bytes > vertex_index_bytes_ ) MemoryAccount::add ( MEM_VERTICES, bytes - vertex_index_bytes_ );
+    else MemoryAccount::sub ( MEM_VERTICES, vertex_index_bytes_ - bytes );
+    vertex_index_bytes_ = bytes;
+  }
+
+  /**
+   *@fn string stateFile ( )
+   *
+   *@return Path of the sorted table of edge states carried over
+   *         between windows while the network is spilled
+   */
+  string stateFile ( ) { return spill_prefix_ + "-edge-state.bin"; }
+
+  /**
+   *@fn static string spillPrefix ( const string& dir )
+   *
+   *@return Path prefix in dir that no other network uses: it holds
+   *         the process id and a count of the networks the process
+   *         built, so runs can share a spill directory
+   */
+  static string spillPrefix ( const string& dir );
+
+  /**
+   *@fn string pendingFile ( )
+   *
+   *@return Path a streamed window's edge list is written to until
+   *         printNetwork gives it its name
+   */
+  string pendingFile ( ) { return spill_prefix_ + "-stream-pending.dat"; }
+
+  /**
+   *@fn uint64_t pairKey ( unsigned int a, unsigned int b )
+   *
+   *@return Key of the pair ( a, b ), a < b, ordered like the pair
+   */
+  static uint64_t pairKey ( unsigned int a, unsigned int b ){
+    return ( ( uint64_t ) a << 32 ) | b;
+  }
+
+  /**
+   *@fn const LagSamplerCache& lagCache ( unique_ptr < Parameters >& P )
+   *
+   *   Cache every edge of the window is weighted with. Kept from
+   * window to window, and rebuilt when the parameters it was built
+   * from have changed since.
+   */
+  const LagSamplerCache& lagCache ( unique_ptr < Parameters >& P ){
+    if ( !lag_cache_->current ( P ) ) lag_cache_.reset ( new LagSamplerCache ( P ) );
+    return *lag_cache_;
+  }
+
+  /**
+   *@fn void addVertices ( const double* energies, unsigned int count )
+   *
+   *  Appends count vertices with the given energies, each drawn from
+   *the node pool, with the next free ids, and extends the energy
+   *index.
+   */
+  void addVertices ( const double* energies, unsigned int count );
+
+  /**
+   *@fn void populateEdgesExternal ( unique_ptr < Parameters >& P, Metrics::Timer& timer )
+   *
+   *    Out-of-core version of populateEdges. Candidate pairs are
+   * written to sorted runs on disk and merged, and the wait time
+   * of every edge is carried over in a sorted on-disk table instead
+   * of in E_. Memory use is bounded by the budget at the cost of
+   * sequential I/O.
+   *
+   *@param P Parameters for the model ( usually from the command line)
+   */
+  void populateEdgesExternal ( unique_ptr < Parameters >& P, Metrics::Timer& timer );
+
+  /**
+   *@fn void populateEdgesStreaming ( unique_ptr < Parameters >& P, Metrics::Timer& timer )
+   *
+   *    Bounded memory version of populateEdges ( -stream ). Each pair
+   * is generated once, by the first community in C_ its two vertices
+   * share ( found with a per-window index of each vertex's
+   * communities ), weighted on the spot and written straight to
+   * pendingFile. External pairs are drawn in fixed blocks. Only the
+   * wait time of each candidate is kept for the next window, in
+   * waits_, so memory is bounded by the community index, waits_ and
+   * one batch of formatted output instead of the whole edge set.
+   *
+   *    Communities and blocks draw from their own streams, so the
+   * result does not depend on the number of threads. Edges come out
+   * in community order, not sorted, and a pair of a -skipsize
+   * community is only a candidate where its first shared community
+   * kept it.
+   *
+   *@param P Parameters for the model ( usually from the command line)
+   */
+  void populateEdgesStreaming ( unique_ptr < Parameters >& P, Metrics::Timer& timer );
+
+  /**
+   *@fn void populateHyperedges ( unique_ptr < Parameters >& P )
+   *
+   *    Samples the window's hyperedges into H_. A community of n
+   * members gets ceil ( hyperrate * n / k ) groups of k = -hyper
+   * distinct members ( all of them if n < k ), drawn uniformly. Each
+   * group is weighted like a new edge, with the lag policy taken over
+   * all of its members. Groups are drawn anew every window and carry
+   * no wait times over; they are not part of the edge list, the
+   * vertex edge counts or the event files.
+   *
+   *    Communities draw from their own streams and are processed in
+   * batches on the pool; groups are kept in community order.
+   *
+   *@param P Parameters for the model ( usually from the command line)
+   */
+  void populateHyperedges ( unique_ptr < Parameters >& P );
+
+  /**
+   *@fn void streamEdgeSet ( )
+   *
+   *    Turns a loaded edge set into a streamed window: writes it to
+   * pendingFile, keeps its wait times in waits_ and empties E_.
+   */
+  void streamEdgeSet ( );
+
+  /**
+   *@fn void recordEdges ( Metrics::Timer& timer, unsigned long generated, unsigned long reused, double interactions, unsigned long active )
+   *@fn void recordEdges ( Metrics::Timer& timer, unsigned long reused )
+   *
+   *  Reports a finished edge phase, and with it the window, to the
+   *metrics. The short form counts weights over the in-memory E_.
+   */
+  void recordEdges ( Metrics::Timer& timer, unsigned long generated, unsigned long reused, double interactions, unsigned long active );
+  void recordEdges ( Metrics::Timer& timer, unsigned long reused );
+
+  /**
+   *@fn void printNetworkSharded ( string filename )
+   *
+   *  Splits the edges into shards_ contiguous ranges of E_ ( or of the
+   *spilled state table ) and writes them concurrently, range K to
+   *'base.part-K' where base is filename without its extension. Parts
+   *concatenated in order give the same list printNetwork writes.
+   *'base.manifest' holds the shard and edge counts, then one
+   *'file edges bytes first_pair last_pair' line per part ( '- -' for
+   *an empty part ).
+   *
+   *@param filename Name the edge list would have unsharded
+   */
+  void printNetworkSharded ( string filename );
+
+  /**
+   *@fn void closeOutput ( ofstream& fout, Metrics::Timer& timer )
+   *
+   *  Closes an output file, counting its bytes in the metrics.
+   */
+  void closeOutput ( ofstream& fout, Metrics::Timer& timer );
+
+  /**
+   *@fn void addBytesWritten ( unsigned long bytes )
+   */
+  void addBytesWritten ( unsigned long bytes ){
+    if ( metrics_ ) metrics_->add ( Metrics::BYTES_WRITTEN, bytes );
+  }
+
+  /**
+   *@fn void spillEdgeSet ( )
+   *
+   *    Moves the current in-memory edge set to the on-disk state
+   * table. E_ is already ordered by ( a, b ), so this is a single
+   * sequential write.
+   */
+  void spillEdgeSet ( );
+
+  /**
+   *@fn void dropEdgeSet ( )
+   *
+   *  Empties E_ and frees the arena its nodes came from.
+   */
+  void dropEdgeSet ( ){
+    eset ( cmp_pedge(), eset::allocator_type ( MEM_EDGE_SET ) ).swap ( E_ );
+  }
+
+  /**
+   *@fn size_t vertexSlot ( unsigned int id )
+   *
+   *  Looks up the position of a vertex in V_ by id with a binary
+   *search, V_ being kept in id order.
+   *
+   *@param id Identifier of a vertex in the network
+   *@return Position of the vertex in V_
+   */
+  size_t vertexSlot ( unsigned int id ){
+    //Ids are handed out densely, so the slot usually matches
+    if ( ( id < V_.size() ) && ( V_[id]->getID() == id ) ) return id;
+
+    return lower_bound ( V_.begin(), V_.end(), id, [] ( const shared_ptr < Vertex >& V, unsigned int i ) { return V->getID() < i; } ) - V_.begin();
+  }
+
+  /**
+   *@fn const shared_ptr < Vertex >& getVertex ( unsigned int id )
+   *
+   *@param id Identifier of a vertex in the network
+   *@return Pointer to the vertex ( see vertexSlot )
+   */
+  const shared_ptr < Vertex >& getVertex ( unsigned int id ){ return V_[vertexSlot ( id )]; }
+
   /**
    *@fn void addCommunity( shared_ptr < Community > C )
    *
    *  Makes sure that each vertex in the community is mapped
    *back to the community as well as the community tracked
-   *for future reference.
+   *for future reference. The community gets the next stable id.
    *
    *@param C Community to add to structure for the network
    */
   void addCommunity( shared_ptr < Community > C ) {
     C_.push_back ( C );
+    com_ids_.push_back ( next_com_id_++ );
     
     const vset c_mem = C->getMembers();
     vset::const_iterator it_c;
     for ( it_c = c_mem.begin(); it_c != c_mem.end(); it_c++ ){
-      membership_.insert(pair < shared_ptr < Vertex >, int > ( *it_c, C_.size() - 1 ) );
+      membership_.insert(pair < shared_ptr < Vertex >, int > ( *it_c, com_ids_.back() ) );
     }
   }
   
+  /**
+   *@fn void visitCommunityPairs ( unsigned int c, F f )
+   *@fn void visitCommunityPairs ( unsigned int c, F f, D draw )
+   *
+   *  Calls f ( A, B ) for the pairs of members of community c that
+   *are edge candidates, with A before B in id order. Communities
+   *smaller than -skipsize give every pair ( a clique ). Larger ones
+   *keep each pair independently with probability -skipdens, using
+   *geometric skips over the pair index ( Batagelj & Brandes, 2005 ),
+   *so the work grows with the pairs kept, not with size^2.
+   *
+   *@param c Index of the community in C_
+   *@param f Callable taking two const shared_ptr < Vertex >&
+   *@param draw Callable returning a uniform double in [0,1) for the
+   *            skips ( rand() based random_double by default )
+   */
+  template < class F >
+  void visitCommunityPairs ( unsigned int c, F f ){
+    visitCommunityPairs ( c, f, [] ( ) { return random_double(); } );
+  }
+
+  template < class F, class D >
+  void visitCommunityPairs ( unsigned int c, F f, D draw ){
+    const vset& members = C_[c]->getMembers();
+
+    if ( ( skip_size_ == 0 ) || ( members.size() < skip_size_ ) || ( skip_density_ >= 1 ) ){
+      vset::const_iterator it_a, it_b;
+      for ( it_a = members.begin(); it_a != members.end(); it_a++ ){
+	it_b = it_a;
+	for ( ++it_b; it_b != members.end(); it_b++ ){
+	  f ( *it_a, *it_b );
+	}
+      }
+      return;
+    }
+    if ( skip_density_ <= 0 ) return;
+
+    //Pairs are walked row by row: ( v, w ) with w < v
+    vector < const shared_ptr < Vertex >* > flat;
+    flat.reserve ( members.size() );
+    vset::const_iterator it_m;
+    for ( it_m = members.begin(); it_m != members.end(); it_m++ ){
+      flat.push_back ( &(*it_m) );
+    }
+
+    long long n = flat.size();
+    long long v = 1, w = -1;
+    double log_q = log ( 1.0 - skip_density_ );
+    while ( v < n ){
+      //Number of pairs skipped before the next one kept
+      w += 1 + ( long long ) floor ( log ( 1.0 - draw() ) / log_q );
+      while ( ( w >= v ) && ( v < n ) ){
+	w -= v;
+	++v;
+      }
+      if ( v < n ) f ( *flat[w], *flat[v] );
+    }
+  }
+
+  /**
+   *@fn void sampleNewMembers ( Group& G, unsigned int count, D draw, vector < size_t >& slots )
+   *
+   *  Draws count distinct vertices, weighted by energy, that are not
+   *members of G yet ( see EnergySampler::sampleDistinct ).
+   *
+   *@param G Group the vertices are drawn for
+   *@param count Number of vertices wanted
+   *@param draw Callable returning a uniform double in [0,1)
+   *@param slots Filled with the positions of the drawn vertices in V_
+   */
+  template < class D >
+  void sampleNewMembers ( Group& G, unsigned int count, D draw, vector < size_t >& slots ){
+    const vset& members = G.getMembers();
+    double member_mass = 0;
+    vset::const_iterator it_m;
+    for ( it_m = members.begin(); it_m != members.end(); it_m++ ){
+      member_mass += (*it_m)->getEnergy();
+    }
+
+    energy_index_.sampleDistinct ( count, draw, [&] ( size_t s ) { return members.count ( V_[s] ) > 0; }, member_mass, slots );
+  }
+
+  /**
+   *@fn void compactCommunities ( )
+   *
+   *  Removes empty communities ( dead or merged away ) from C_, so
+   *later windows do not keep looping over them. Order and stable
+   *ids of the remaining communities are kept. Only run with -compact,
+   *since birthEvents and deathEvents then see fewer communities.
+   */
+  void compactCommunities ( );
+
+  /**
+   *@fn unsigned int retireVertices ( double prob, unsigned int max_age )
+   *
+   * Removes vertices from the network for good. A vertex retires
+   *    with probability prob each window, and always once it has been
+   *    in max_age windows ( 0 = no age limit ). Retired vertices leave
+   *    their communities and edges, and the energy index is rebuilt
+   *    over the survivors. Ids are tombstoned, never handed out again,
+   *    so an id means the same vertex in every output file.
+   *
+   *    Carried over edge state of a spilled network is not touched:
+   *    retired pairs are never generated again, so the next merge-join
+   *    drops them.
+   *
+   *@param prob Probability a vertex retires in a window
+   *@param max_age Windows a vertex lives at most
+   *@return Number of vertices retired
+   */
+  unsigned int retireVertices ( double prob, unsigned int max_age );
+
   /**
    *@fn void deathEvents ( double dprob )
    *
@@ -315,6 +955,13 @@ class Network{
    * community is chosen to grow. Otherwise it shrinks. Amount of
    * change is up to a sgr percentage of the size of the community.
    *
+   *    Communities are processed on the pool ( in order on the
+   * calling thread with one thread ). Each draws from its own stream
+   * seeded by ( seed, window, community ), and new memberships are
+   * recorded per community and applied to membership_ in community
+   * order once all are done. The result only depends on the seed,
+   * not on the number of threads or how they were scheduled.
+   *
    *@param pgr Probability a community grows
    *@param sgr Maximum percentage of size that a community can
    *           either grow or shrink
@@ -0,0 +1,160 @@
+/**
+ *@file NodePool.cc
+ *
+ *   Definitions for the shared side of the node pool, and for the
+ * slabs of node arenas.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "NodePool.h"
+#include <mutex>
+
+/**
+ *@struct SharedLists
+ *
+ *   Free lists shared by all threads, one lock per size class. Created
+ * on first use and never destroyed, so sets held in static objects
+ * and caches of threads that exit late can still give nodes back.
+ */
+struct SharedLists {
+  mutex lock[NodePool::CLASSES];
+  void* head[NodePool::CLASSES];
+  size_t reserved;
+  mutex reserved_lock;
+
+  SharedLists ( ): reserved(0) {
+    for ( size_t c = 0; c < NodePool::CLASSES; c++ ) head[c] = NULL;
+  }
+};
+
+static SharedLists& shared ( ){
+  static SharedLists* lists = new SharedLists();
+  return *lists;
+}
+
+thread_local NodePool::Cache NodePool::cache_;
+
+NodePool::Cache::Cache ( ){
+  for ( size_t c = 0; c < CLASSES; c++ ){
+    head[c] = NULL;
+    count[c] = 0;
+  }
+}
+
+NodePool::Cache::~Cache ( ){
+  SharedLists& lists = shared();
+  for ( size_t c = 0; c < CLASSES; c++ ){
+    if ( !head[c] ) continue;
+
+    FreeNode* tail = head[c];
+    while ( tail->next ) tail = tail->next;
+
+    lock_guard < mutex > guard ( lists.lock[c] );
+    tail->next = static_cast < FreeNode* > ( lists.head[c] );
+    lists.head[c] = head[c];
+    head[c] = NULL;
+    count[c] = 0;
+  }
+}
+
+void NodePool::refill ( Cache& cache, size_t c ){
+  SharedLists& lists = shared();
+  {
+    lock_guard < mutex > guard ( lists.lock[c] );
+    FreeNode* node = static_cast < FreeNode* > ( lists.head[c] );
+    while ( node && ( cache.count[c] < BATCH ) ){
+      FreeNode* next = node->next;
+      node->next = cache.head[c];
+      cache.head[c] = node;
+      ++cache.count[c];
+      node = next;
+    }
+    lists.head[c] = node;
+  }
+  if ( cache.head[c] ) return;
+
+  //Shared list was empty: the new slab goes to this thread, except
+  //   for what is left over after one batch
+  size_t node_size = ( c + 1 ) * ALIGN;
+  size_t nodes = SLAB / node_size;
+  char* slab = static_cast < char* > ( ::operator new ( SLAB ) );
+  {
+    lock_guard < mutex > guard ( lists.reserved_lock );
+    lists.reserved += SLAB;
+  }
+
+  FreeNode* spare = NULL;
+  for ( size_t i = nodes; i-- > 0; ){
+    FreeNode* node = reinterpret_cast < FreeNode* > ( slab + i * node_size );
+    if ( i < BATCH ){
+      node->next = cache.head[c];
+      cache.head[c] = node;
+      ++cache.count[c];
+    } else {
+      node->next = spare;
+      spare = node;
+    }
+  }
+
+  if ( spare ){
+    FreeNode* tail = reinterpret_cast < FreeNode* > ( slab + ( nodes - 1 ) * node_size );
+    lock_guard < mutex > guard ( lists.lock[c] );
+    tail->next = static_cast < FreeNode* > ( lists.head[c] );
+    lists.head[c] = spare;
+  }
+}
+
+void NodePool::release ( Cache& cache, size_t c ){
+  FreeNode* first = cache.head[c];
+  FreeNode* last = first;
+  for ( size_t i = 1; i < BATCH; i++ ) last = last->next;
+
+  cache.head[c] = last->next;
+  cache.count[c] -= BATCH;
+
+  SharedLists& lists = shared();
+  lock_guard < mutex > guard ( lists.lock[c] );
+  last->next = static_cast < FreeNode* > ( lists.head[c] );
+  lists.head[c] = first;
+}
+
+size_t NodePool::reserved ( ){
+  SharedLists& lists = shared();
+  lock_guard < mutex > guard ( lists.reserved_lock );
+  return lists.reserved;
+}
+
+NodeArena::NodeArena ( ): next_(NULL), left_(0) {
+  for ( size_t c = 0; c < NodePool::CLASSES; c++ ) free_[c] = NULL;
+}
+
+NodeArena::~NodeArena ( ){
+  for ( size_t s = 0; s < slabs_.size(); s++ ){
+    ::operator delete ( slabs_[s] );
+  }
+}
+
+void NodeArena::grow ( ){
+  slabs_.push_back ( static_cast < char* > ( ::operator new ( NodePool::SLAB ) ) );
+  next_ = slabs_.back();
+  left_ = NodePool::SLAB;
+}
@@ -0,0 +1,295 @@
+/**
+ *@file NodePool.h
+ *
+ *   Size-class pool for the small, fixed-size nodes of the vertex and
+ * edge sets. Every community, edge and window allocates and frees set
+ * nodes one at a time; taking them from per-thread free lists avoids a
+ * trip through malloc for each one and keeps nodes of a set close
+ * together in memory. Containers that die as a whole, like a window's
+ * edge set, can instead take their nodes from a NodeArena of their
+ * own and give all of its memory back at once.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_NODEPOOL
+#define RPI_NODEPOOL
+
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+using namespace std;
+
+/**
+ *@class NodePool
+ *
+ *   Requests up to MAX_SIZE bytes are rounded up to a multiple of
+ * ALIGN and served from the free list of that size class. Each thread
+ * keeps its own lists and trades nodes with a shared list BATCH at a
+ * time, so the lock is taken once per BATCH allocations or frees.
+ * The shared lists are refilled by cutting SLAB byte blocks into
+ * nodes. Slabs are kept for the life of the program: freed nodes go
+ * back to the lists one at a time and are reused by the next window
+ * rather than returned to the system, so the pool stays at the size
+ * of the largest window built so far.
+ *
+ *   Larger requests go straight to operator new.
+ */
+class NodePool {
+ public:
+  static const size_t ALIGN = 16;
+  static const size_t MAX_SIZE = 256;
+  static const size_t CLASSES = MAX_SIZE / ALIGN;
+  static const size_t BATCH = 64;
+  static const size_t SLAB = 64 * 1024;
+
+  static void* allocate ( size_t bytes ){
+    if ( bytes > MAX_SIZE ) return ::operator new ( bytes );
+
+    size_t c = sizeClass ( bytes );
+    Cache& cache = cache_;
+    if ( !cache.head[c] ) refill ( cache, c );
+
+    FreeNode* node = cache.head[c];
+    cache.head[c] = node->next;
+    --cache.count[c];
+    return node;
+  }
+
+  static void deallocate ( void* p, size_t bytes ){
+    if ( bytes > MAX_SIZE ) { ::operator delete ( p ); return; }
+
+    size_t c = sizeClass ( bytes );
+    Cache& cache = cache_;
+    FreeNode* node = static_cast < FreeNode* > ( p );
+    node->next = cache.head[c];
+    cache.head[c] = node;
+
+    //Freeing a whole set on one thread would otherwise pile every
+    //   node into that thread's list
+    if ( ++cache.count[c] > 2 * BATCH ) release ( cache, c );
+  }
+
+  /**
+   *@fn size_t reserved ( )
+   *
+   *@return Bytes taken from the system for slabs so far. Never
+   *          decreases, since slabs are not freed
+   */
+  static size_t reserved ( );
+
+ private:
+  struct FreeNode {
+    FreeNode* next;
+  };
+
+  /**
+   *@struct Cache
+   *
+   *   One thread's free lists. Nodes still held when the thread exits
+   * are handed back to the shared lists.
+   */
+  struct Cache {
+    FreeNode* head[CLASSES];
+    size_t count[CLASSES];
+
+    Cache ( );
+    ~Cache ( );
+  };
+
+  static thread_local Cache cache_;
+
+  static size_t sizeClass ( size_t bytes ){
+    return ( bytes == 0 ) ? 0 : ( bytes - 1 ) / ALIGN;
+  }
+
+  /**
+   *@fn void refill ( Cache& cache, size_t c )
+   *
+   *   Moves up to BATCH nodes of class c from the shared list into
+   * cache, cutting a new slab first if the shared list is empty.
+   */
+  static void refill ( Cache& cache, size_t c );
+
+  /**
+   *@fn void release ( Cache& cache, size_t c )
+   *
+   *   Moves BATCH nodes of class c from cache to the shared list.
+   */
+  static void release ( Cache& cache, size_t c );
+};
+
+/**
+ *@class PoolAllocator
+ *
+ *   Standard allocator drawing single objects from NodePool. Arrays
+ * ( which node containers never ask for ) use operator new. The
+ * allocator has no state, so any two instances are interchangeable
+ * and containers using it can be swapped and moved freely.
+ */
+template < class T >
+class PoolAllocator {
+ public:
+  typedef T value_type;
+
+  PoolAllocator ( ) { }
+  template < class U >
+  PoolAllocator ( const PoolAllocator < U >& ) { }
+
+  T* allocate ( size_t n ){
+    if ( n == 1 ) return static_cast < T* > ( NodePool::allocate ( sizeof ( T ) ) );
+    return static_cast < T* > ( ::operator new ( n * sizeof ( T ) ) );
+  }
+
+  void deallocate ( T* p, size_t n ){
+    if ( n == 1 ) NodePool::deallocate ( p, sizeof ( T ) );
+    else ::operator delete ( p );
+  }
+};
+
+template < class T, class U >
+bool operator== ( const PoolAllocator < T >&, const PoolAllocator < U >& ) { return true; }
+
+template < class T, class U >
+bool operator!= ( const PoolAllocator < T >&, const PoolAllocator < U >& ) { return false; }
+
+/**
+ *@class NodeArena
+ *
+ *   One generation of nodes. Nodes are cut from SLAB byte slabs of
+ * the arena's own, and a node freed while the arena lives goes on the
+ * arena's free list for its size class, so a container that erases
+ * as it goes does not grow. All slabs are released together when the
+ * arena is destroyed. Like the container using it, an arena is only
+ * changed by one thread at a time.
+ *
+ *   Requests over NodePool::MAX_SIZE go straight to operator new.
+ */
+class NodeArena {
+ public:
+  NodeArena ( );
+  ~NodeArena ( );
+
+  void* allocate ( size_t bytes ){
+    if ( bytes > NodePool::MAX_SIZE ) return ::operator new ( bytes );
+
+    size_t c = ( bytes == 0 ) ? 0 : ( bytes - 1 ) / NodePool::ALIGN;
+    if ( free_[c] ){
+      FreeNode* node = free_[c];
+      free_[c] = node->next;
+      return node;
+    }
+
+    size_t node_size = ( c + 1 ) * NodePool::ALIGN;
+    if ( left_ < node_size ) grow ( );
+    void* res = next_;
+    next_ += node_size;
+    left_ -= node_size;
+    return res;
+  }
+
+  void deallocate ( void* p, size_t bytes ){
+    if ( bytes > NodePool::MAX_SIZE ) { ::operator delete ( p ); return; }
+
+    size_t c = ( bytes == 0 ) ? 0 : ( bytes - 1 ) / NodePool::ALIGN;
+    FreeNode* node = static_cast < FreeNode* > ( p );
+    node->next = free_[c];
+    free_[c] = node;
+  }
+
+  /**
+   *@fn size_t reserved ( ) const
+   *
+   *@return Bytes of slabs the arena holds
+   */
+  size_t reserved ( ) const { return slabs_.size() * NodePool::SLAB; }
+
+ private:
+  struct FreeNode {
+    FreeNode* next;
+  };
+
+  vector < char* > slabs_;
+  char* next_;                            //Uncut part of the last slab
+  size_t left_;
+  FreeNode* free_[NodePool::CLASSES];
+
+  /**
+   *@fn void grow ( )
+   *
+   *   Starts cutting nodes from a new slab. What was left of the last
+   * one is too small for the request and is not used.
+   */
+  void grow ( );
+
+  NodeArena ( const NodeArena& );
+  NodeArena& operator= ( const NodeArena& );
+};
+
+/**
+ *@class ArenaAllocator
+ *
+ *   Standard allocator drawing single objects from a NodeArena that
+ * its copies and rebound copies share. A default built allocator
+ * starts a new arena, so each container built with one has a
+ * generation of its own, freed in one step once the container and
+ * every copy of its allocator are gone. The arena goes with the
+ * contents when containers are swapped or move assigned, and two
+ * allocators are equal only if they share an arena.
+ */
+template < class T >
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef true_type propagate_on_container_swap;
+  typedef true_type propagate_on_container_move_assignment;
+  typedef true_type propagate_on_container_copy_assignment;
+
+  ArenaAllocator ( ): arena_ ( make_shared < NodeArena > () ) { }
+  template < class U >
+  ArenaAllocator ( const ArenaAllocator < U >& other ): arena_ ( other.arena() ) { }
+
+  T* allocate ( size_t n ){
+    if ( n == 1 ) return static_cast < T* > ( arena_->allocate ( sizeof ( T ) ) );
+    return static_cast < T* > ( ::operator new ( n * sizeof ( T ) ) );
+  }
+
+  void deallocate ( T* p, size_t n ){
+    if ( n == 1 ) arena_->deallocate ( p, sizeof ( T ) );
+    else ::operator delete ( p );
+  }
+
+  const shared_ptr < NodeArena >& arena ( ) const { return arena_; }
+
+ private:
+  shared_ptr < NodeArena > arena_;
+};
+
+template < class T, class U >
+bool operator== ( const ArenaAllocator < T >& a, const ArenaAllocator < U >& b ) { return a.arena() == b.arena(); }
+
+template < class T, class U >
+bool operator!= ( const ArenaAllocator < T >& a, const ArenaAllocator < U >& b ) { return a.arena() != b.arena(); }
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ *@file PerfCounters.cc
+ *
+ *   Definitions for the hardware performance counters.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PerfCounters.h"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+static const char* NAMES[PerfCounters::NUM_EVENTS] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+
+static const uint64_t CONFIGS[PerfCounters::NUM_EVENTS] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+PerfCounters::PerfCounters ( ){
+  for ( int e = 0; e < NUM_EVENTS; e++ ){
+    struct perf_event_attr attr;
+    memset ( &attr, 0, sizeof ( attr ) );
+    attr.size = sizeof ( attr );
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = CONFIGS[e];
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    //This process and its threads, on any cpu
+    fds_[e] = syscall ( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+    if ( ( fds_[e] < 0 ) && error_.empty() ){
+      error_ = string ( NAMES[e] ) + ": " + strerror ( errno );
+    }
+  }
+}
+
+PerfCounters::~PerfCounters ( ){
+  for ( int e = 0; e < NUM_EVENTS; e++ ){
+    if ( fds_[e] >= 0 ) close ( fds_[e] );
+  }
+}
+
+bool PerfCounters::available ( ) const {
+  for ( int e = 0; e < NUM_EVENTS; e++ ){
+    if ( fds_[e] >= 0 ) return true;
+  }
+  return false;
+}
+
+void PerfCounters::read ( uint64_t values[NUM_EVENTS] ) const {
+  for ( int e = 0; e < NUM_EVENTS; e++ ){
+    values[e] = 0;
+    if ( fds_[e] < 0 ) continue;
+
+    //value, time enabled, time running
+    uint64_t data[3];
+    if ( ::read ( fds_[e], data, sizeof ( data ) ) != sizeof ( data ) ) continue;
+    if ( ( data[2] > 0 ) && ( data[2] < data[1] ) ){
+      values[e] = ( uint64_t ) ( ( double ) data[0] * data[1] / data[2] );
+    } else {
+      values[e] = data[0];
+    }
+  }
+}
+
+const char* PerfCounters::name ( Event e ){
+  return NAMES[e];
+}
@@ -0,0 +1,126 @@
+/**
+ *@file PerfCounters.h
+ *
+ *   Hardware performance counters of the process, read through Linux
+ * perf_event_open ( -profile ). Counts cycles, instructions, cache
+ * misses and branch misses in user space, for the main thread and
+ * every thread started after the counters are opened ( the thread
+ * pool is created afterwards for that reason ).
+ *
+ *   Counters the kernel or the machine does not provide ( no PMU in a
+ * virtual machine, perf_event_paranoid too strict, ... ) are simply
+ * left out; the others still count.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_PERFCOUNTERS
+#define RPI_PERFCOUNTERS
+
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+/**
+ *@class PerfCounters
+ *
+ *   Running totals of a fixed set of events. Totals are scaled up
+ * when the kernel had to multiplex the counters.
+ */
+class PerfCounters {
+ public:
+  enum Event {
+    CYCLES = 0,
+    INSTRUCTIONS,
+    CACHE_MISSES,            //Last level cache misses
+    BRANCH_MISSES,
+    NUM_EVENTS
+  };
+
+  /**
+   *@fn PerfCounters ( )
+   *
+   *   Opens every counter it can. Never throws; see available().
+   */
+  PerfCounters ( );
+  ~PerfCounters ( );
+
+  /**
+   *@fn bool available ( ) const
+   *@fn bool available ( Event e ) const
+   *
+   *@return Whether any counter, or counter e, could be opened
+   */
+  bool available ( ) const;
+  bool available ( Event e ) const { return fds_[e] >= 0; }
+
+  /**
+   *@fn string error ( ) const
+   *
+   *@return Why the first counter that failed could not be opened
+   */
+  const string& error ( ) const { return error_; }
+
+  /**
+   *@fn void read ( uint64_t values[NUM_EVENTS] ) const
+   *
+   *   Fills in the totals so far ( 0 for unavailable events ).
+   */
+  void read ( uint64_t values[NUM_EVENTS] ) const;
+
+  static const char* name ( Event e );
+
+  /**
+   *@class PerfCounters::Scope
+   *
+   *   Adds the counts between construction and destruction to totals.
+   * Safe to use with NULL counters, in which case it does nothing.
+   */
+  class Scope {
+  public:
+    Scope ( const PerfCounters* counters, uint64_t* totals ): counters_ ( counters ), totals_ ( totals ) {
+      if ( counters_ ) counters_->read ( start_ );
+    }
+    ~Scope ( ){
+      if ( !counters_ ) return;
+      uint64_t end[NUM_EVENTS];
+      counters_->read ( end );
+      //Scaled totals of multiplexed counters can step back a little
+      for ( int e = 0; e < NUM_EVENTS; e++ ){
+	if ( end[e] > start_[e] ) totals_[e] += end[e] - start_[e];
+      }
+    }
+  private:
+    const PerfCounters* counters_;
+    uint64_t* totals_;
+    uint64_t start_[NUM_EVENTS];
+  };
+
+ private:
+  int fds_[NUM_EVENTS];
+  string error_;
+
+  PerfCounters ( const PerfCounters& );
+  PerfCounters& operator= ( const PerfCounters& );
+};
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ *@file RandomStream.h
+ *
+ *   Independent, reproducible random streams. Work that is spread
+ * over threads draws from a stream seeded by what it is working on
+ * ( window, community, ... ) instead of the global rand() state, so
+ * results do not depend on which thread does the work or when.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_RSTREAM
+#define RPI_RSTREAM
+
+#include <random>
+#include <cstdint>
+
+typedef std::mt19937_64 rstream;
+
+/**
+ *@enum StreamKind
+ *
+ *   What a stream is used for. Part of the seed, so that different
+ * phases working on the same window and id never share a stream.
+ */
+enum StreamKind {
+  STREAM_GROW = 1,         //growAndShrink, per community
+  STREAM_SPLIT,            //mergeAndSplit, per community
+  STREAM_WEIGHT,           //edge weights, per block of edges
+  STREAM_STATS,            //GraphStats sampling
+  STREAM_EMIT,             //streamed edges, per community
+  STREAM_EXTERNAL,         //streamed external edges, per block of draws
+  STREAM_HYPER             //hyperedges, per community
+};
+
+/**
+ *@fn uint64_t streamSeed ( uint64_t seed, StreamKind kind, uint64_t a, uint64_t b )
+ *
+ *   Combines a run seed with a stream kind and two identifiers into
+ * the seed of a stream. Uses the splitmix64 finalizer so that
+ * neighbouring ids give unrelated streams.
+ *
+ *@param seed Seed of the run
+ *@param kind Phase the stream is used in
+ *@param a First identifier ( usually the window )
+ *@param b Second identifier ( community, chunk, ... )
+ *@return Seed for an rstream
+ */
+inline uint64_t streamSeed ( uint64_t seed, StreamKind kind, uint64_t a, uint64_t b ){
+  uint64_t z = seed;
+  uint64_t ids[3] = { ( uint64_t ) kind, a, b };
+  for ( int i = 0; i < 3; i++ ){
+    z += 0x9E3779B97F4A7C15ULL + ids[i];
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+    z = z ^ ( z >> 31 );
+  }
+  return z;
+}
+
+/**
+ *@fn double uniform ( rstream& rng )
+ *
+ *@return Uniform double in [0,1) built from the top 53 bits of a draw
+ */
+inline double uniform ( rstream& rng ){
+  return ( rng() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+/**
+ *@fn double uniform ( rstream& rng, double low, double high )
+ *
+ *@return Uniform double in [low,high)
+ */
+inline double uniform ( rstream& rng, double low, double high ){
+  return low + ( high - low ) * uniform ( rng );
+}
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ *@file ShmRing.cc
+ *
+ *   Definitions for the shared memory window ring.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ShmRing.h"
+#include <stdexcept>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char SHM_MAGIC[8] = "RPISHM1";
+
+//Slots start on a cache line after the header
+static const size_t SLOTS_AT = ( ( sizeof ( ShmRingHeader ) + 63 ) / 64 ) * 64;
+
+static string segmentName ( const string& name ){
+  return ( !name.empty() && ( name[0] == '/' ) ) ? name : "/" + name;
+}
+
+/**
+ *@fn void backOff ( unsigned int& tries )
+ *
+ *   Waiting step while the other side catches up: yields at first,
+ * then sleeps 100 microseconds at a time.
+ */
+static void backOff ( unsigned int& tries ){
+  if ( ++tries < 64 ){
+    sched_yield();
+    return;
+  }
+  struct timespec pause = { 0, 100000 };
+  nanosleep ( &pause, NULL );
+}
+
+ShmRingWriter::ShmRingWriter ( const string& name, uint32_t slots, uint64_t slot_bytes ): name_ ( segmentName ( name ) ), base_ ( NULL ), size_ ( 0 ), chunk_ ( NULL ), records_ ( NULL ), capacity_ ( 0 ), count_ ( 0 ), window_ ( 0 ), bytes_ ( 0 ) {
+  slots = max < uint32_t > ( slots, 2 );
+  slot_bytes = ( ( max < uint64_t > ( slot_bytes, sizeof ( ShmChunkHeader ) + sizeof ( BinaryEdgeRecord ) ) + 63 ) / 64 ) * 64;
+  size_ = SLOTS_AT + slots * slot_bytes;
+
+  //A segment left by an earlier run is replaced
+  shm_unlink ( name_.c_str() );
+  int fd = shm_open ( name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+  if ( fd < 0 ) throw runtime_error ( "Unable to create shared memory " + name_ );
+  if ( ftruncate ( fd, size_ ) != 0 ){
+    close ( fd );
+    shm_unlink ( name_.c_str() );
+    throw runtime_error ( "Unable to size shared memory " + name_ );
+  }
+  void* res = mmap ( NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close ( fd );
+  if ( res == MAP_FAILED ){
+    shm_unlink ( name_.c_str() );
+    throw runtime_error ( "Unable to map shared memory " + name_ );
+  }
+  base_ = static_cast < unsigned char* > ( res );
+
+  header_ = new ( base_ ) ShmRingHeader;
+  header_->slots = slots;
+  header_->reserved = 0;
+  header_->slot_bytes = slot_bytes;
+  header_->published.store ( 0, memory_order_relaxed );
+  header_->consumed.store ( 0, memory_order_relaxed );
+  header_->closed.store ( 0, memory_order_relaxed );
+  capacity_ = ( slot_bytes - sizeof ( ShmChunkHeader ) ) / sizeof ( BinaryEdgeRecord );
+
+  //Readers check the magic, so it goes in once the rest is set
+  atomic_thread_fence ( memory_order_release );
+  memcpy ( header_->magic, SHM_MAGIC, sizeof ( SHM_MAGIC ) );
+}
+
+ShmRingWriter::~ShmRingWriter ( ){
+  header_->closed.store ( 1, memory_order_release );
+  munmap ( base_, size_ );
+}
+
+void ShmRingWriter::beginWindow ( uint32_t window ){
+  window_ = window;
+  bytes_ = 0;
+  acquire();
+}
+
+unsigned long ShmRingWriter::endWindow ( ){
+  publish ( CHUNK_LAST );
+  return bytes_;
+}
+
+void ShmRingWriter::acquire ( ){
+  uint64_t sequence = header_->published.load ( memory_order_relaxed );
+  unsigned int tries = 0;
+  while ( sequence - header_->consumed.load ( memory_order_acquire ) >= header_->slots ){
+    backOff ( tries );
+  }
+
+  chunk_ = reinterpret_cast < ShmChunkHeader* > ( base_ + SLOTS_AT + ( sequence % header_->slots ) * header_->slot_bytes );
+  records_ = reinterpret_cast < BinaryEdgeRecord* > ( chunk_ + 1 );
+  chunk_->sequence = sequence;
+  chunk_->window = window_;
+  chunk_->reserved = 0;
+  count_ = 0;
+}
+
+void ShmRingWriter::publish ( uint32_t flags ){
+  chunk_->flags = flags;
+  chunk_->records = count_;
+  bytes_ += sizeof ( ShmChunkHeader ) + count_ * sizeof ( BinaryEdgeRecord );
+  header_->published.store ( chunk_->sequence + 1, memory_order_release );
+
+  if ( !( flags & CHUNK_LAST ) ) acquire();
+}
+
+ShmRingReader::ShmRingReader ( const string& name ): name_ ( segmentName ( name ) ), base_ ( NULL ), size_ ( 0 ), next_ ( 0 ) {
+  int fd = shm_open ( name_.c_str(), O_RDWR, 0 );
+  if ( fd < 0 ) throw runtime_error ( "Unable to open shared memory " + name_ );
+
+  struct stat info;
+  if ( ( fstat ( fd, &info ) != 0 ) || ( ( size_t ) info.st_size < SLOTS_AT ) ){
+    close ( fd );
+    throw runtime_error ( name_ + " is not a window ring" );
+  }
+  size_ = info.st_size;
+
+  void* res = mmap ( NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close ( fd );
+  if ( res == MAP_FAILED ) throw runtime_error ( "Unable to map shared memory " + name_ );
+  base_ = static_cast < unsigned char* > ( res );
+  header_ = reinterpret_cast < ShmRingHeader* > ( base_ );
+
+  if ( memcmp ( header_->magic, SHM_MAGIC, sizeof ( SHM_MAGIC ) ) != 0 ){
+    munmap ( base_, size_ );
+    throw runtime_error ( name_ + " is not a window ring" );
+  }
+  atomic_thread_fence ( memory_order_acquire );
+  next_ = header_->consumed.load ( memory_order_acquire );
+}
+
+ShmRingReader::~ShmRingReader ( ){
+  munmap ( base_, size_ );
+}
+
+bool ShmRingReader::next ( ShmChunk& chunk ){
+  unsigned int tries = 0;
+  while ( header_->published.load ( memory_order_acquire ) <= next_ ){
+    //Chunks published before closing are still read
+    if ( header_->closed.load ( memory_order_acquire ) && ( header_->published.load ( memory_order_acquire ) <= next_ ) ) return false;
+    backOff ( tries );
+  }
+
+  const ShmChunkHeader* head = reinterpret_cast < const ShmChunkHeader* > ( base_ + SLOTS_AT + ( next_ % header_->slots ) * header_->slot_bytes );
+  chunk.window = head->window;
+  chunk.last = ( head->flags & CHUNK_LAST ) != 0;
+  chunk.count = head->records;
+  chunk.records = reinterpret_cast < const BinaryEdgeRecord* > ( head + 1 );
+  return true;
+}
+
+void ShmRingReader::release ( ){
+  header_->consumed.store ( ++next_, memory_order_release );
+}
+
+void ShmRingReader::unlink ( ){
+  shm_unlink ( name_.c_str() );
+}
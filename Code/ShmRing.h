@@ -0,0 +1,237 @@
+/**
+ *@file ShmRing.h
+ *
+ *   Hands finished windows to a process on the same host through a
+ * POSIX shared memory ring ( -shm ), instead of edge list files.
+ *
+ *   The segment starts with a ShmRingHeader, followed by 'slots'
+ * slots of 'slot_bytes' each. A slot holds one chunk: a
+ * ShmChunkHeader and then packed BinaryEdgeRecord edges. A window is
+ * one or more chunks, the last one flagged CHUNK_LAST; a window with
+ * no edges is a single empty chunk.
+ *
+ *   There is one producer and one consumer. Chunk n goes in slot
+ * n % slots. The producer writes a chunk, then raises 'published' to
+ * n + 1; the consumer reads it in place and raises 'consumed' to
+ * n + 1 once done with it. The producer waits before reusing a slot
+ * the consumer has not released, so a slow consumer holds the model
+ * back instead of losing windows. The producer sets 'closed' when it
+ * is done and leaves the segment for the consumer to unlink.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_SHMRING
+#define RPI_SHMRING
+
+#include "Loader.h"
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+using namespace std;
+
+static_assert ( ATOMIC_LLONG_LOCK_FREE == 2, "shared memory counters need lock-free 64 bit atomics" );
+
+/**
+ *@struct ShmRingHeader
+ *
+ *   Start of the segment. The counters sit on cache lines of their
+ * own, as each side writes one of them.
+ */
+struct ShmRingHeader {
+  char magic[8];                     //"RPISHM1", written last
+  uint32_t slots;                    //Slots in the ring
+  uint32_t reserved;
+  uint64_t slot_bytes;               //Bytes per slot, header included
+  alignas ( 64 ) atomic < uint64_t > published; //Chunks written
+  alignas ( 64 ) atomic < uint64_t > consumed;  //Chunks released
+  alignas ( 64 ) atomic < uint32_t > closed;    //1 once no more chunks come
+};
+
+/**
+ *@struct ShmChunkHeader
+ *
+ *   Start of a slot; records BinaryEdgeRecord follow it.
+ */
+struct ShmChunkHeader {
+  uint64_t sequence;                 //Number of the chunk in the ring
+  uint32_t window;                   //Window the edges belong to
+  uint32_t flags;                    //CHUNK_LAST on a window's last chunk
+  uint64_t records;                  //Edges in the chunk
+  uint64_t reserved;
+};
+
+static const uint32_t CHUNK_LAST = 1;
+
+/**
+ *@class ShmRingWriter
+ *
+ *   Producer side. Edges are written straight into the current slot;
+ * a full slot is published and the next one taken.
+ */
+class ShmRingWriter {
+ public:
+  /**
+   *@fn ShmRingWriter ( const string& name, uint32_t slots, uint64_t slot_bytes )
+   *
+   *   Creates the segment, replacing a stale one of the same name.
+   * Throws runtime_error if it cannot be created or mapped.
+   *
+   *@param name Segment name ( a leading '/' is added if missing )
+   *@param slots Slots in the ring ( at least 2 )
+   *@param slot_bytes Bytes per slot ( room for at least one edge )
+   */
+  ShmRingWriter ( const string& name, uint32_t slots, uint64_t slot_bytes );
+
+  /**
+   *@fn ~ShmRingWriter ( )
+   *
+   *   Marks the ring closed and unmaps it.
+   */
+  ~ShmRingWriter ( );
+
+  /**
+   *@fn void beginWindow ( uint32_t window )
+   *
+   *   Starts the chunks of a window, waiting for a free slot.
+   */
+  void beginWindow ( uint32_t window );
+
+  /**
+   *@fn void push ( uint32_t a, uint32_t b, double weight )
+   *
+   *   Adds an edge to the window being written.
+   */
+  void push ( uint32_t a, uint32_t b, double weight ){
+    if ( count_ == capacity_ ) publish ( 0 );
+    BinaryEdgeRecord& rec = records_[count_++];
+    rec.a = a;
+    rec.b = b;
+    rec.weight = weight;
+  }
+
+  /**
+   *@fn unsigned long endWindow ( )
+   *
+   *   Publishes the window's last chunk.
+   *
+   *@return Bytes of the window's chunks
+   */
+  unsigned long endWindow ( );
+
+ private:
+  string name_;
+  unsigned char* base_;              //Mapping of the whole segment
+  size_t size_;
+  ShmRingHeader* header_;
+  ShmChunkHeader* chunk_;            //Chunk being written
+  BinaryEdgeRecord* records_;        //Its edges
+  uint64_t capacity_;                //Edges that fit in a slot
+  uint64_t count_;                   //Edges in the chunk so far
+  uint32_t window_;
+  unsigned long bytes_;              //Bytes of the window so far
+
+  /**
+   *@fn void acquire ( )
+   *
+   *   Waits until the slot of the next chunk is released and starts
+   * the chunk there.
+   */
+  void acquire ( );
+
+  /**
+   *@fn void publish ( uint32_t flags )
+   *
+   *   Hands the current chunk to the consumer and, unless it ends the
+   * window, starts the next one.
+   */
+  void publish ( uint32_t flags );
+
+  ShmRingWriter ( const ShmRingWriter& );
+  ShmRingWriter& operator= ( const ShmRingWriter& );
+};
+
+/**
+ *@struct ShmChunk
+ *
+ *   A chunk as the consumer sees it. records points into the segment
+ * and stays valid until ShmRingReader::release.
+ */
+struct ShmChunk {
+  uint32_t window;
+  bool last;                         //Last chunk of the window
+  uint64_t count;
+  const BinaryEdgeRecord* records;
+};
+
+/**
+ *@class ShmRingReader
+ *
+ *   Consumer side. Chunks are read in place, in order.
+ */
+class ShmRingReader {
+ public:
+  /**
+   *@fn ShmRingReader ( const string& name )
+   *
+   *   Maps an existing ring. Throws runtime_error if there is no such
+   * segment or it is not ( yet ) a ring.
+   */
+  ShmRingReader ( const string& name );
+  ~ShmRingReader ( );
+
+  /**
+   *@fn bool next ( ShmChunk& chunk )
+   *
+   *   Waits for the next chunk. The previous one must be released.
+   *
+   *@return False once the producer closed the ring and every chunk
+   *         was read
+   */
+  bool next ( ShmChunk& chunk );
+
+  /**
+   *@fn void release ( )
+   *
+   *   Gives the slot of the chunk from next back to the producer.
+   */
+  void release ( );
+
+  /**
+   *@fn void unlink ( )
+   *
+   *   Removes the segment name; the mapping stays valid.
+   */
+  void unlink ( );
+
+ private:
+  string name_;
+  unsigned char* base_;
+  size_t size_;
+  ShmRingHeader* header_;
+  uint64_t next_;                    //Sequence of the next chunk
+
+  ShmRingReader ( const ShmRingReader& );
+  ShmRingReader& operator= ( const ShmRingReader& );
+};
+
+#endif
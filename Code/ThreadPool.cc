@@ -0,0 +1,180 @@
+/**
+ *@file ThreadPool.cc
+ *
+ *   Definitions of the member functions for the ThreadPool and
+ * TaskGroup classes.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadPool.h"
+
+//Queue owned by the current thread, if it is a worker of some pool
+static thread_local const void* current_pool = NULL;
+static thread_local unsigned int current_queue = 0;
+
+void TaskGroup::run ( const function < void() >& task ){
+  if ( pool_.serial() ){
+    task();
+    return;
+  }
+
+  ++pending_;
+  ThreadPool::Task t;
+  t.fn = task;
+  t.group = this;
+  pool_.push ( t );
+}
+
+void TaskGroup::wait ( ){
+  drain();
+
+  if ( failed_ ){
+    exception_ptr error;
+    {
+      lock_guard < mutex > guard ( error_lock_ );
+      error = error_;
+      error_ = exception_ptr();
+      failed_ = false;
+    }
+    rethrow_exception ( error );
+  }
+}
+
+void TaskGroup::drain ( ){
+  //Helps out instead of blocking, so nested waits cannot deadlock
+  ThreadPool::Task task;
+  while ( pending_ > 0 ){
+    if ( pool_.take ( task ) ){
+      pool_.execute ( task );
+    } else {
+      this_thread::yield();
+    }
+  }
+}
+
+void TaskGroup::fail ( exception_ptr error ){
+  lock_guard < mutex > guard ( error_lock_ );
+  if ( !error_ ) error_ = error;
+  failed_ = true;
+}
+
+ThreadPool::ThreadPool ( int threads ): queued_(0), stop_(false) {
+  if ( threads < 1 ) threads = 1;
+
+  for ( int i = 0; i < threads; i++ ){
+    queues_.push_back ( unique_ptr < Queue > ( new Queue() ) );
+  }
+  for ( int i = 1; i < threads; i++ ){
+    workers_.push_back ( thread ( &ThreadPool::workerLoop, this, i ) );
+  }
+}
+
+ThreadPool::~ThreadPool ( ){
+  {
+    lock_guard < mutex > guard ( sleep_lock_ );
+    stop_ = true;
+  }
+  wake_.notify_all();
+
+  for ( unsigned int i = 0; i < workers_.size(); i++ ){
+    workers_[i].join();
+  }
+}
+
+unsigned int ThreadPool::threadIndex ( ){
+  return ( current_pool == this ) ? current_queue : 0;
+}
+
+void ThreadPool::push ( const Task& task ){
+  //Workers push to their own deque, outside threads to queue 0
+  unsigned int q = ( current_pool == this ) ? current_queue : 0;
+  {
+    lock_guard < mutex > guard ( queues_[q]->lock );
+    queues_[q]->tasks.push_back ( task );
+  }
+
+  //Taking the lock orders this against a worker about to sleep
+  ++queued_;
+  {
+    lock_guard < mutex > guard ( sleep_lock_ );
+  }
+  wake_.notify_one();
+}
+
+bool ThreadPool::take ( Task& task ){
+  unsigned int own = ( current_pool == this ) ? current_queue : 0;
+
+  //Newest task from our own deque first ( best cache locality )
+  {
+    lock_guard < mutex > guard ( queues_[own]->lock );
+    if ( !queues_[own]->tasks.empty() ){
+      task = queues_[own]->tasks.back();
+      queues_[own]->tasks.pop_back();
+      --queued_;
+      return true;
+    }
+  }
+
+  //Otherwise steal the oldest ( biggest ) task from someone else
+  for ( unsigned int i = 1; i < queues_.size(); i++ ){
+    unsigned int victim = ( own + i ) % queues_.size();
+    lock_guard < mutex > guard ( queues_[victim]->lock );
+    if ( !queues_[victim]->tasks.empty() ){
+      task = queues_[victim]->tasks.front();
+      queues_[victim]->tasks.pop_front();
+      --queued_;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::execute ( Task& task ){
+  //An exception must not leave a worker; the group's waiter gets it
+  if ( !task.group->failed_ ){
+    try {
+      task.fn();
+    } catch ( ... ) {
+      task.group->fail ( current_exception() );
+    }
+  }
+  --task.group->pending_;
+}
+
+void ThreadPool::workerLoop ( unsigned int index ){
+  current_pool = this;
+  current_queue = index;
+
+  Task task;
+  while ( true ){
+    if ( take ( task ) ){
+      execute ( task );
+      continue;
+    }
+
+    unique_lock < mutex > guard ( sleep_lock_ );
+    if ( stop_ ) return;
+    wake_.wait ( guard, [this] ( ) { return stop_ || ( queued_ > 0 ); } );
+    if ( stop_ ) return;
+  }
+}
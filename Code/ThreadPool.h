@@ -0,0 +1,209 @@
+/**
+ *@file ThreadPool.h
+ *
+ *   Persistent work-stealing thread pool shared by every parallel
+ * phase of window generation.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_TPOOL
+#define RPI_TPOOL
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+
+using namespace std;
+
+class ThreadPool;
+
+/**
+ *@class TaskGroup
+ *
+ *   A set of tasks that can be waited on together. Tasks may add
+ * more tasks to the same group while running. The first exception a
+ * task throws is kept and rethrown by wait; tasks of the group that
+ * have not started by then are skipped.
+ */
+class TaskGroup {
+ public:
+ TaskGroup ( ThreadPool& pool ): pool_(pool), pending_(0), failed_(false) {}
+  ~TaskGroup ( ) { drain(); }
+
+  /**
+   *@fn void run ( const function < void() >& task )
+   *
+   *   Queues a task. In serial mode the task runs immediately.
+   */
+  void run ( const function < void() >& task );
+
+  /**
+   *@fn void wait ( )
+   *
+   *   Returns once every task in the group has finished. The calling
+   * thread runs queued tasks ( from any group ) while it waits.
+   *
+   *@throws The first exception thrown by a task of the group
+   */
+  void wait ( );
+
+ private:
+  friend class ThreadPool;
+  ThreadPool& pool_;
+  atomic < long > pending_;
+  atomic < bool > failed_;
+  mutex error_lock_;
+  exception_ptr error_;
+
+  /**
+   *@fn void drain ( )
+   *
+   *   Waits like wait, without rethrowing.
+   */
+  void drain ( );
+
+  /**
+   *@fn void fail ( exception_ptr error )
+   *
+   *   Keeps error if it is the group's first.
+   */
+  void fail ( exception_ptr error );
+};
+
+/**
+ *@class ThreadPool
+ *
+ *   Each worker owns a deque of tasks. Workers push and pop at the
+ * back of their own deque and steal from the front of others' when
+ * they run dry, so big tasks that split themselves keep every core
+ * busy even when the amount of work per item is very skewed ( as it
+ * is for power law community sizes ).
+ *
+ *   A pool built with one thread has no workers at all: everything
+ * runs in order on the calling thread, which is handy for debugging.
+ */
+class ThreadPool {
+ public:
+  /**
+   *@fn ThreadPool ( int threads )
+   *
+   *@param threads Total threads doing work, including the caller
+   */
+  ThreadPool ( int threads );
+  ~ThreadPool ( );
+
+  /**
+   *@fn int size ( )
+   *
+   *@return Number of threads doing work ( 1 in serial mode )
+   */
+  int size ( ) { return workers_.size() + 1; }
+
+  /**
+   *@fn bool serial ( )
+   *
+   *@return True if all work runs on the calling thread
+   */
+  bool serial ( ) { return workers_.empty(); }
+
+  /**
+   *@fn unsigned int threadIndex ( )
+   *
+   *@return Index in [0, size()) of the calling thread: workers are
+   *         1 and up, any thread outside the pool counts as 0. Lets
+   *         callers keep per-thread state without locking, as long as
+   *         only one outside thread drives the pool.
+   */
+  unsigned int threadIndex ( );
+
+  /**
+   *@fn void parallelFor ( size_t begin, size_t end, size_t grain, F body )
+   *
+   *   Calls body ( lo, hi ) on disjoint sub-ranges covering
+   * [begin, end). Ranges are split in half on demand: a task keeps
+   * the left half and makes the right half available for stealing
+   * until its range is at most grain long, so splitting adapts to
+   * how unevenly the work is spread.
+   *
+   *@param grain Ranges this short are never split further
+   *@param body Callable taking ( size_t lo, size_t hi )
+   */
+  template < class F >
+  void parallelFor ( size_t begin, size_t end, size_t grain, F body ){
+    if ( begin >= end ) return;
+    if ( grain == 0 ) grain = 1;
+
+    if ( serial() ){
+      body ( begin, end );
+      return;
+    }
+
+    TaskGroup group ( *this );
+    splitRange ( group, begin, end, grain, body );
+    group.wait();
+  }
+
+ private:
+  friend class TaskGroup;
+
+  struct Task {
+    function < void() > fn;
+    TaskGroup* group;
+  };
+
+  struct Queue {
+    mutex lock;
+    deque < Task > tasks;
+  };
+
+  vector < thread > workers_;
+  vector < unique_ptr < Queue > > queues_;   //One per worker, plus one
+                                             //   for outside threads
+  mutex sleep_lock_;
+  condition_variable wake_;
+  atomic < long > queued_;
+  atomic < bool > stop_;
+
+  template < class F >
+  void splitRange ( TaskGroup& group, size_t lo, size_t hi, size_t grain, F body ){
+    while ( hi - lo > grain ){
+      size_t mid = lo + ( hi - lo ) / 2;
+      size_t right = hi;
+      group.run ( [this, &group, mid, right, grain, body] ( ) { splitRange ( group, mid, right, grain, body ); } );
+      hi = mid;
+    }
+    body ( lo, hi );
+  }
+
+  void push ( const Task& task );
+  bool take ( Task& task );
+  void execute ( Task& task );
+  void workerLoop ( unsigned int index );
+};
+
+#endif
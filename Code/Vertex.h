@@ -28,6 +28,7 @@ This file is part of RPI-evo-model.
 
 #include <set>
 #include "../../Libraries/Files/StringEx.h"
+#include "MemoryAccount.h"
 
 #include <tr1/memory>
 
@@ -158,11 +159,21 @@ class Vertex {
  * Simply calls through to the overloaded operator<()
  */
 struct cmp_vptr {
-  bool operator () ( const shared_ptr < Vertex >& A, const shared_ptr < Vertex >& B ){
+  bool operator () ( const shared_ptr < Vertex >& A, const shared_ptr < Vertex >& B ) const {
     return ( *A < *B );
   }
 };
 
-typedef set < shared_ptr < Vertex >, cmp_vptr > vset;
+/**
+ *@typedef basic_vset
+ *
+ * Vertex set with a chosen allocator for its nodes. vset, used
+ *     throughout, takes its nodes from the NodePool and charges them
+ *     to the tag it is built with ( see MemoryAccount.h ).
+ */
+template < class Alloc = TrackedAllocator < shared_ptr < Vertex > > >
+using basic_vset = set < shared_ptr < Vertex >, cmp_vptr, Alloc >;
+
+typedef basic_vset < > vset;
 
 #endif
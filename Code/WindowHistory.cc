@@ -0,0 +1,193 @@
+/**
+ *@file WindowHistory.cc
+ *
+ *   Definitions of the member functions for the WindowHistory class.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "WindowHistory.h"
+#include <set>
+#include <numeric>
+
+WindowHistory::WindowHistory ( unsigned int depth ): depth_ ( max ( depth, 1u ) ) {}
+
+const WindowHistory::Snapshot* WindowHistory::find ( int window ) const {
+  if ( snapshots_.empty() || ( window < oldest() ) || ( window > newest() ) ) return NULL;
+  return &snapshots_[window - oldest()];
+}
+
+void WindowHistory::capture ( Network& N ){
+  Snapshot snap;
+  snap.window = N.getWindow();
+  snap.vertices = N.NumVerts();
+
+  //Edges, as a delta against the current keyframe
+  PairChunk pairs;
+  N.visitEdges ( [&] ( unsigned int a, unsigned int b, double w ) {
+      PairRecord p;
+      p.a = a;
+      p.b = b;
+      pairs.push_back ( p );
+      snap.weights.push_back ( w );
+    } );
+
+  //A streamed window comes in community order; the delta and the
+  //   bitmap below need ( a, b ) order
+  if ( !is_sorted ( pairs.begin(), pairs.end() ) ){
+    vector < unsigned int > order ( pairs.size() );
+    iota ( order.begin(), order.end(), 0 );
+    sort ( order.begin(), order.end(), [&] ( unsigned int x, unsigned int y ) { return pairs[x] < pairs[y]; } );
+
+    PairChunk sorted_pairs ( pairs.size() );
+    vector < float > sorted_weights ( pairs.size() );
+    for ( size_t i = 0; i < order.size(); i++ ){
+      sorted_pairs[i] = pairs[order[i]];
+      sorted_weights[i] = snap.weights[order[i]];
+    }
+    pairs.swap ( sorted_pairs );
+    snap.weights.swap ( sorted_weights );
+  }
+  snap.weights.shrink_to_fit();
+
+  if ( keyframe_ ){
+    set_difference ( pairs.begin(), pairs.end(), keyframe_->begin(), keyframe_->end(), back_inserter ( snap.added ) );
+  }
+  if ( !keyframe_ || ( snap.added.size() * 2 > keyframe_->size() ) ){
+    keyframe_.reset ( new PairChunk ( pairs ) );
+    PairChunk ().swap ( snap.added );
+  }
+  snap.keyframe = keyframe_;
+  snap.added.shrink_to_fit();
+
+  //Marks the keyframe pairs present in this window
+  const PairChunk& frame = *keyframe_;
+  snap.kept.assign ( ( frame.size() + 63 ) / 64, 0 );
+  size_t p = 0;
+  for ( size_t k = 0; k < frame.size(); k++ ){
+    while ( ( p < pairs.size() ) && ( pairs[p] < frame[k] ) ) ++p;
+    if ( ( p < pairs.size() ) && ( pairs[p] == frame[k] ) ) snap.kept[k >> 6] |= 1ULL << ( k & 63 );
+  }
+  snap.rank.assign ( snap.kept.size(), 0 );
+  for ( size_t w = 1; w < snap.kept.size(); w++ ){
+    snap.rank[w] = snap.rank[w-1] + __builtin_popcountll ( snap.kept[w-1] );
+  }
+
+  //Communities, shared by id when the members did not change
+  unordered_map < unsigned int, shared_ptr < const MemberChunk > > previous;
+  if ( !snapshots_.empty() ){
+    const Snapshot& last = snapshots_.back();
+    for ( size_t c = 0; c < last.communities.size(); c++ ){
+      previous[last.communities[c].first] = last.communities[c].second;
+    }
+  }
+
+  N.visitCommunities ( [&] ( unsigned int id, const vset& members ) {
+      MemberChunk ids;
+      ids.reserve ( members.size() );
+      for ( vset::const_iterator it_m = members.begin(); it_m != members.end(); it_m++ ){
+	ids.push_back ( (*it_m)->getID() );
+      }
+
+      auto it_p = previous.find ( id );
+      if ( ( it_p != previous.end() ) && ( *it_p->second == ids ) ){
+	snap.communities.push_back ( make_pair ( id, it_p->second ) );
+      } else {
+	snap.communities.push_back ( make_pair ( id, shared_ptr < const MemberChunk > ( new MemberChunk ( ids ) ) ) );
+      }
+    } );
+
+  //Windows are kept as a consecutive range
+  if ( !snapshots_.empty() && ( snap.window != newest() + 1 ) ){
+    snapshots_.clear();
+  }
+  snapshots_.push_back ( snap );
+  while ( snapshots_.size() > depth_ ){
+    snapshots_.pop_front();
+  }
+}
+
+unsigned int WindowHistory::numVertices ( int window ) const {
+  const Snapshot* snap = find ( window );
+  return snap ? snap->vertices : 0;
+}
+
+unsigned long WindowHistory::numEdges ( int window ) const {
+  const Snapshot* snap = find ( window );
+  return snap ? snap->weights.size() : 0;
+}
+
+double WindowHistory::edgeWeight ( int window, unsigned int a, unsigned int b ) const {
+  const Snapshot* snap = find ( window );
+  if ( !snap ) return 0;
+
+  PairRecord key;
+  key.a = min ( a, b );
+  key.b = max ( a, b );
+
+  //Position of the pair in the window's order is the number of
+  //   window pairs before it: kept keyframe pairs plus added pairs
+  const PairChunk& frame = *snap->keyframe;
+  size_t k = lower_bound ( frame.begin(), frame.end(), key ) - frame.begin();
+  PairChunk::const_iterator it_a = lower_bound ( snap->added.begin(), snap->added.end(), key );
+
+  bool in_frame = ( k < frame.size() ) && ( frame[k] == key ) && kept ( *snap, k );
+  bool in_added = ( it_a != snap->added.end() ) && ( *it_a == key );
+  if ( !in_frame && !in_added ) return 0;
+
+  //Kept bits below k: whole words from the rank table, then the
+  //   low bits of k's own word
+  size_t word = k >> 6, kept_before = 0;
+  if ( word < snap->rank.size() ){
+    kept_before = snap->rank[word] + __builtin_popcountll ( snap->kept[word] & ( ( 1ULL << ( k & 63 ) ) - 1 ) );
+  } else if ( !snap->rank.empty() ){
+    kept_before = snap->rank.back() + __builtin_popcountll ( snap->kept.back() );
+  }
+  return snap->weights[kept_before + ( it_a - snap->added.begin() )];
+}
+
+vector < unsigned int > WindowHistory::communitiesOf ( int window, unsigned int v ) const {
+  vector < unsigned int > res;
+  forEachCommunity ( window, [&] ( unsigned int id, const MemberChunk& members ) {
+      if ( binary_search ( members.begin(), members.end(), v ) ) res.push_back ( id );
+    } );
+  return res;
+}
+
+size_t WindowHistory::bytes ( ) const {
+  set < const void* > seen;
+  size_t res = 0;
+
+  for ( size_t s = 0; s < snapshots_.size(); s++ ){
+    const Snapshot& snap = snapshots_[s];
+    res += sizeof ( Snapshot ) + snap.weights.capacity() * sizeof ( float );
+    res += snap.added.capacity() * sizeof ( PairRecord );
+    res += snap.kept.capacity() * sizeof ( uint64_t ) + snap.rank.capacity() * sizeof ( uint32_t );
+    res += snap.communities.capacity() * sizeof ( snap.communities[0] );
+
+    if ( seen.insert ( snap.keyframe.get() ).second ) res += snap.keyframe->capacity() * sizeof ( PairRecord );
+    for ( size_t c = 0; c < snap.communities.size(); c++ ){
+      if ( seen.insert ( snap.communities[c].second.get() ).second ) res += snap.communities[c].second->capacity() * sizeof ( unsigned int );
+    }
+  }
+
+  return res;
+}
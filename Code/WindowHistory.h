@@ -0,0 +1,188 @@
+/**
+ *@file WindowHistory.h
+ *
+ *   Keeps the last few windows of a run in memory for sliding-window
+ * analysis, sharing whatever did not change between windows.
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPI_HISTORY
+#define RPI_HISTORY
+
+#include "Network.h"
+#include <deque>
+#include <unordered_map>
+#include <iterator>
+
+using namespace std;
+
+/**
+ *@class WindowHistory
+ *
+ *   Snapshots of the last K windows of a network, built from
+ * immutable pieces shared between windows:
+ *      - each community's sorted member list is one chunk, reused by
+ *          the next window if the community did not change
+ *      - edge pairs are stored as a shared sorted keyframe plus, per
+ *          window, a bitmap of the keyframe pairs still present and
+ *          the sorted pairs added since. A new keyframe is cut once a
+ *          window adds more than half as many pairs as the keyframe
+ *          holds.
+ *
+ *   Delta runs were picked over chunking the pair list: external
+ * edges are redrawn uniformly every window, which touches nearly
+ * every chunk of any useful size, while a delta costs one bit per
+ * keyframe pair plus the pairs that actually appeared.
+ *
+ *   Weights change with nearly every window, so they are kept per
+ * window as floats. Memory therefore grows with the number of changed
+ * communities and pairs, plus 4 bytes per edge and window, instead of
+ * K full copies.
+ */
+class WindowHistory {
+ public:
+  typedef vector < PairRecord > PairChunk;
+  typedef vector < unsigned int > MemberChunk;
+
+  /**
+   *@fn WindowHistory ( unsigned int depth )
+   *
+   *@param depth Number of windows kept ( K )
+   */
+  WindowHistory ( unsigned int depth );
+
+  /**
+   *@fn void capture ( Network& N )
+   *
+   *   Snapshots the window N currently holds, dropping the oldest
+   * snapshot if K are already kept. Edges are sorted first when N
+   * does not visit them in ( a, b ) order, as for a streamed window.
+   */
+  void capture ( Network& N );
+
+  /**
+   *@fn bool has ( int window ) const
+   *@fn int oldest ( ) const
+   *@fn int newest ( ) const
+   *
+   *   Windows kept are the consecutive range [oldest, newest].
+   */
+  bool has ( int window ) const { return find ( window ) != NULL; }
+  int oldest ( ) const { return snapshots_.empty() ? -1 : snapshots_.front().window; }
+  int newest ( ) const { return snapshots_.empty() ? -1 : snapshots_.back().window; }
+
+  /**
+   *@fn unsigned int numVertices ( int window ) const
+   *@fn unsigned long numEdges ( int window ) const
+   */
+  unsigned int numVertices ( int window ) const;
+  unsigned long numEdges ( int window ) const;
+
+  /**
+   *@fn void forEachEdge ( int window, F f ) const
+   *
+   *   Calls f ( a, b, weight ) for each edge of a kept window, in
+   * ( a, b ) order. Does nothing for windows not kept.
+   */
+  template < class F >
+  void forEachEdge ( int window, F f ) const {
+    const Snapshot* snap = find ( window );
+    if ( !snap ) return;
+
+    //Merges the kept keyframe pairs with the added ones
+    const PairChunk& key = *snap->keyframe;
+    size_t k = 0, a = 0, e = 0;
+    while ( ( k < key.size() ) || ( a < snap->added.size() ) ){
+      if ( ( k < key.size() ) && !kept ( *snap, k ) ){
+	++k;
+	continue;
+      }
+
+      const PairRecord& next = ( ( a == snap->added.size() ) || ( ( k < key.size() ) && ( key[k] < snap->added[a] ) ) ) ? key[k++] : snap->added[a++];
+      f ( next.a, next.b, ( double ) snap->weights[e++] );
+    }
+  }
+
+  /**
+   *@fn void forEachCommunity ( int window, F f ) const
+   *
+   *   Calls f ( id, members ) for each non-empty community of a kept
+   * window, members being the sorted vertex ids.
+   */
+  template < class F >
+  void forEachCommunity ( int window, F f ) const {
+    const Snapshot* snap = find ( window );
+    if ( !snap ) return;
+
+    for ( size_t c = 0; c < snap->communities.size(); c++ ){
+      f ( snap->communities[c].first, ( const MemberChunk& ) *snap->communities[c].second );
+    }
+  }
+
+  /**
+   *@fn double edgeWeight ( int window, unsigned int a, unsigned int b ) const
+   *
+   *@return Weight of the edge between a and b in the window ( 0 if
+   *         there is none, or the window is not kept )
+   */
+  double edgeWeight ( int window, unsigned int a, unsigned int b ) const;
+
+  /**
+   *@fn vector < unsigned int > communitiesOf ( int window, unsigned int v ) const
+   *
+   *@return Ids of the communities v belongs to in the window
+   */
+  vector < unsigned int > communitiesOf ( int window, unsigned int v ) const;
+
+  /**
+   *@fn size_t bytes ( ) const
+   *
+   *@return Approximate memory held by all kept windows, counting
+   *         each shared chunk once
+   */
+  size_t bytes ( ) const;
+
+ private:
+  struct Snapshot {
+    int window;
+    unsigned int vertices;
+    shared_ptr < const PairChunk > keyframe;
+    PairChunk added;                           //Pairs not in keyframe
+    vector < uint64_t > kept;                  //Bit per keyframe pair
+    vector < uint32_t > rank;                  //Kept bits before each word
+    vector < float > weights;                  //One per edge, in order
+    vector < pair < unsigned int, shared_ptr < const MemberChunk > > > communities;
+  };
+
+  unsigned int depth_;
+  deque < Snapshot > snapshots_;
+
+  shared_ptr < const PairChunk > keyframe_;    //Keyframe of new windows
+
+  const Snapshot* find ( int window ) const;
+
+  static bool kept ( const Snapshot& snap, size_t k ) {
+    return ( snap.kept[k >> 6] >> ( k & 63 ) ) & 1;
+  }
+};
+
+#endif
@@ -29,27 +29,36 @@
 #include <iostream>
 
 #include "../../Libraries/Params/Parameters.h"
-#include "Network.h"
+#include "EvoModel.h"
+#include "GraphStats.h"
 
 using namespace std;
 
 int main ( int argc, char** argv ){
-  //Reads in the command line arguments
-  unique_ptr < Parameters > P ( new Parameters () );
-  P->Read(argc, argv);
+  try {
+    //Reads in the command line arguments
+    EvoModel model ( argc, argv );
+    unique_ptr < Parameters >& P = model.parameters();
+    Network& N = model.network();
   
-  //Creates the first time window's static network
-  unique_ptr < Network> N ( new Network ( P ) );
-  N->RandomNetwork ( P );
-  N->printNetwork ( "Network0.dat" );
+    unsigned int t = P->get < unsigned int > ( "t", 10 );
   
-  unsigned int t = P->get < unsigned int > ( "t", 10 );
-  
-  //Iteratively constructs following time windows, 
-  //   printing out the information as it goes
-  for ( unsigned int i = 1; i < t; i++ ){
-    cout << "Constructing window " << i << endl;
-    N->genNextTimeWindow( P );
-    N->printNetwork ( "Network" + to_str < unsigned int > ( i ) + ".dat" );
-  }  
+    //Constructs the first time window's static network, then 
+    //   iteratively constructs following time windows, printing
+    //   out the information as it goes
+    model.run ( t, [&] ( WindowView& W ) {
+	string i = to_str < unsigned int > ( W.window() );
+	if ( W.window() > 0 ) cout << "Constructed window " << i << endl;
+
+	N.printNetwork ( "Network" + i + ".dat" );
+	if ( P->hasFlag ( "index" ) ) N.printIndex ( "Network" + i + ".idx" );
+	if ( P->hasFlag ( "hyper" ) ) N.printHyperedges ( "Hyperedges" + i + ".dat" );
+	if ( P->hasFlag ( "shm" ) ) N.publishWindow();
+	if ( P->hasFlag ( "gt" ) ) N.printCommunities ( "Communities" + i + ".dat" );
+	if ( P->hasFlag ( "stats" ) ) GraphStats ( N, P ).write ( "Stats" + i + ".dat" );
+      } );
+  } catch ( const exception& e ){
+    cerr << e.what() << endl;
+    return 1;
+  }
 }
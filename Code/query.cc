@@ -0,0 +1,131 @@
+/**
+ *@file query.cc
+ *
+ *   Command line lookups in indexed windows ( see EdgeIndex.h ).
+ *
+ *     query index EDGES INDEX [threads]
+ *         Builds INDEX from an edge list, or from all parts listed in
+ *         a NetworkN.manifest
+ *     query neighbors INDEX v
+ *         Prints 'u weight' for each neighbor u of v
+ *     query edge INDEX u v
+ *         Prints the weight of ( u, v ), 0 if absent
+ *     query series PREFIX first last u v
+ *         Prints 't weight' of ( u, v ) in windows first to last,
+ *         reading PREFIXt.idx
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "EdgeIndex.h"
+
+using namespace std;
+
+static int usage ( ){
+  cerr << "Usage: query index EDGES INDEX [threads]\n"
+       << "       query neighbors INDEX v\n"
+       << "       query edge INDEX u v\n"
+       << "       query series PREFIX first last u v\n";
+  return 1;
+}
+
+/**
+ *@fn vector < BinaryEdgeRecord > readEdges ( const string& filename, ThreadPool& pool )
+ *
+ *   Reads an edge list, or every part named in a manifest written by
+ * Network::printNetworkSharded.
+ */
+static vector < BinaryEdgeRecord > readEdges ( const string& filename, ThreadPool& pool ){
+  const string suffix = ".manifest";
+  if ( ( filename.size() < suffix.size() ) || ( filename.compare ( filename.size() - suffix.size(), suffix.size(), suffix ) != 0 ) ){
+    return loadEdgeList ( filename, false, pool );
+  }
+
+  //Part names are relative to the manifest's directory
+  string dir;
+  size_t slash = filename.rfind ( '/' );
+  if ( slash != string::npos ) dir = filename.substr ( 0, slash + 1 );
+
+  ifstream manifest ( filename.c_str() );
+  if ( !manifest ) throw runtime_error ( "Unable to open " + filename );
+
+  vector < BinaryEdgeRecord > res;
+  string line;
+  while ( getline ( manifest, line ) ){
+    istringstream fields ( line );
+    string part;
+    fields >> part;
+    if ( ( part == "shards" ) || ( part == "edges" ) || part.empty() ) continue;
+
+    if ( part[0] != '/' ) part = dir + part;
+    vector < BinaryEdgeRecord > edges = loadEdgeList ( part, false, pool );
+    res.insert ( res.end(), edges.begin(), edges.end() );
+  }
+  return res;
+}
+
+int main ( int argc, char** argv ){
+  if ( argc < 3 ) return usage();
+  string cmd = argv[1];
+
+  try {
+    if ( ( cmd == "index" ) && ( argc >= 4 ) ){
+      ThreadPool pool ( ( argc > 4 ) ? atoi ( argv[4] ) : 1 );
+      vector < BinaryEdgeRecord > edges = readEdges ( argv[2], pool );
+      writeEdgeIndex ( argv[3], edges, pool );
+      cout << edges.size() << " edges indexed" << endl;
+    } else if ( ( cmd == "neighbors" ) && ( argc == 4 ) ){
+      EdgeIndex index ( argv[2] );
+      unsigned int v = strtoul ( argv[3], NULL, 10 );
+      const uint32_t* ids = index.neighbors ( v );
+      const double* weights = index.weights ( v );
+      for ( unsigned long i = 0; i < index.degree ( v ); i++ ){
+	cout << ids[i] << " " << weights[i] << "\n";
+      }
+    } else if ( ( cmd == "edge" ) && ( argc == 5 ) ){
+      EdgeIndex index ( argv[2] );
+      cout << index.weight ( strtoul ( argv[3], NULL, 10 ), strtoul ( argv[4], NULL, 10 ) ) << endl;
+    } else if ( ( cmd == "series" ) && ( argc == 7 ) ){
+      string prefix = argv[2];
+      unsigned int first = strtoul ( argv[3], NULL, 10 ), last = strtoul ( argv[4], NULL, 10 );
+      unsigned int u = strtoul ( argv[5], NULL, 10 ), v = strtoul ( argv[6], NULL, 10 );
+      for ( unsigned int t = first; t <= last; t++ ){
+	ostringstream filename;
+	filename << prefix << t << ".idx";
+	EdgeIndex index ( filename.str() );
+	cout << t << " " << index.weight ( u, v ) << "\n";
+      }
+    } else {
+      return usage();
+    }
+  } catch ( const exception& e ){
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ *@file shm_consumer.cc
+ *
+ *   Example consumer of the shared memory window ring ( see
+ * ShmRing.h ). Attaches to the ring a model run publishes with
+ * -shm NAME and prints, for each window, its number of edges and
+ * total weight. Edges are read in place; nothing is copied.
+ *
+ *     shm_consumer NAME [wait_seconds]
+ *         Waits up to wait_seconds ( default 30 ) for the ring to
+ *         appear, reads until the model closes it, then removes it
+ *
+ *@author James Thompson
+ *
+ * Copyright James Thompson 2015
+ * This program is distributed under the terms of the GNU General Public License
+
+ This file is part of RPI-evo-model.
+
+    RPI-evo-model is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    RPI-evo-model is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with RPI-evo-model.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <memory>
+#include <unistd.h>
+
+#include "ShmRing.h"
+
+using namespace std;
+
+int main ( int argc, char** argv ){
+  if ( argc < 2 ){
+    cerr << "Usage: shm_consumer NAME [wait_seconds]\n";
+    return 1;
+  }
+  int wait = ( argc > 2 ) ? atoi ( argv[2] ) : 30;
+
+  //The model may not have created the ring yet
+  unique_ptr < ShmRingReader > ring;
+  for ( int tries = 0; !ring; tries++ ){
+    try {
+      ring.reset ( new ShmRingReader ( argv[1] ) );
+    } catch ( const exception& e ){
+      if ( tries >= wait * 10 ){
+	cerr << e.what() << endl;
+	return 1;
+      }
+      usleep ( 100000 );
+    }
+  }
+
+  ShmChunk chunk;
+  unsigned long edges = 0;
+  double weight = 0;
+  while ( ring->next ( chunk ) ){
+    for ( uint64_t e = 0; e < chunk.count; e++ ){
+      weight += chunk.records[e].weight;
+    }
+    edges += chunk.count;
+
+    if ( chunk.last ){
+      cout << "window " << chunk.window << " edges " << edges << " weight " << weight << endl;
+      edges = 0;
+      weight = 0;
+    }
+    ring->release();
+  }
+
+  ring->unlink();
+  return 0;
+}